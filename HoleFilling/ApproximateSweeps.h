@@ -0,0 +1,148 @@
+#ifndef APPROXIMATE_SWEEPS_H
+#define APPROXIMATE_SWEEPS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "HoleLayers.h"
+#include "ParallelFor.h"
+#include "WeightFunction.h"
+
+// Colored sweeps use a thread per this many pixels of a color at most, as
+// smaller shares are not worth starting a thread for.
+#define COLORED_SWEEP_PIXELS_PER_THREAD 4096
+
+/**
+ * @brief How the approximate algorithm sweeps over a hole.
+ */
+struct SweepOptions {
+  int maxSweeps;
+  double residualTolerance;
+  // Update the pixels color by color instead of layer by layer.
+  bool colored;
+  int threadCount;
+};
+
+/**
+ * @brief How many sweeps the approximate algorithm ran over a hole, and the
+ * maximal change of a pixel in the last one.
+ */
+struct SweepResult {
+  int sweepsAmount;
+  double residual;
+};
+
+/**
+ * @brief Returns the color of a pixel in colored sweeps. No two neighbors
+ * share a color: 2 colors (red-black) for 4-connectivity and 4 for
+ * 8-connectivity.
+ */
+inline int GetSweepColor (const Pixel &pixel, const int connectivity)
+{
+  if (connectivity == 8)
+    return ((pixel.first & 1) << 1) | (pixel.second & 1);
+  return (pixel.first + pixel.second) & 1;
+}
+
+/**
+ * @brief Runs the sweeps of the approximate algorithm over the pixels of a
+ * hole until the residual is within the tolerance or the maximum number of
+ * sweeps was run.
+ *
+ * A sweep visits the pixels layer by layer. In colored sweeps, only the first
+ * one does, so every pixel has a value, and the next ones visit the pixels
+ * color by color. As pixels of a color are not neighbors, they are updated
+ * concurrently, and the result does not depend on the number of threads.
+ *
+ * @param layers The layers of the hole pixels.
+ * @param connectivity The connectivity, 4 or 8.
+ * @param options The sweep options.
+ * @param update Called as `double update (const Pixel &holePixel, int layer)`
+ * to update a hole pixel, returning how much it changed.
+ */
+template <typename UpdateFunction>
+SweepResult RunSweeps (const HoleLayers &layers, const int connectivity,
+                       const SweepOptions &options,
+                       const UpdateFunction &update)
+{
+  const std::vector<Pixel> &layerPixels = layers.Pixels ();
+  SweepResult result {0, 0};
+
+  auto layeredSweep = [&] ()
+  {
+    double residual = 0;
+    for (int layer = 1; layer <= layers.LayersAmount (); ++layer)
+      {
+        for (std::size_t k = layers.LayerBegin (layer);
+             k < layers.LayerEnd (layer); ++k)
+          {
+            residual = std::max (residual, update (layerPixels[k], layer));
+          }
+      }
+    return residual;
+  };
+
+  if (!options.colored)
+    {
+      do
+        {
+          result.residual = layeredSweep ();
+          result.sweepsAmount += 1;
+        }
+      while (result.sweepsAmount < options.maxSweeps
+             && result.residual > options.residualTolerance);
+      return result;
+    }
+
+  // The pixels of every color, with their layers, in layer order.
+  int colorsAmount = (connectivity == 8) ? 4 : 2;
+  std::vector<std::vector<std::pair<Pixel, int>>> colorPixels (colorsAmount);
+  for (int layer = 1; layer <= layers.LayersAmount (); ++layer)
+    {
+      for (std::size_t k = layers.LayerBegin (layer);
+           k < layers.LayerEnd (layer); ++k)
+        {
+          colorPixels[GetSweepColor (layerPixels[k], connectivity)]
+              .push_back (std::make_pair (layerPixels[k], layer));
+        }
+    }
+
+  result.residual = layeredSweep ();
+  result.sweepsAmount = 1;
+
+  std::mutex residualMutex;
+  while (result.sweepsAmount < options.maxSweeps
+         && result.residual > options.residualTolerance)
+    {
+      result.residual = 0;
+      for (const std::vector<std::pair<Pixel, int>> &pixels : colorPixels)
+        {
+          int threadCount = (int) std::min<std::size_t> (
+              options.threadCount,
+              pixels.size () / COLORED_SWEEP_PIXELS_PER_THREAD + 1);
+
+          ParallelFor (pixels.size (), threadCount,
+                       [&] (std::size_t begin, std::size_t end)
+                       {
+                         double residual = 0;
+                         for (std::size_t i = begin; i < end; ++i)
+                           {
+                             residual = std::max (
+                                 residual,
+                                 update (pixels[i].first, pixels[i].second));
+                           }
+
+                         std::lock_guard<std::mutex> lock (residualMutex);
+                         result.residual = std::max (result.residual,
+                                                     residual);
+                       });
+        }
+      result.sweepsAmount += 1;
+    }
+
+  return result;
+}
+
+#endif // APPROXIMATE_SWEEPS_H
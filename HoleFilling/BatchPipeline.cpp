@@ -0,0 +1,344 @@
+#include "BatchPipeline.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "ImageMasker.h"
+#include "MyWeightFunction.h"
+
+#define MSG_ERR_OPEN_MANIFEST "Error: Could not open the manifest file: "
+#define MSG_ERR_MANIFEST_ROW "Error: Invalid manifest row "
+#define MSG_ERR_MANIFEST_COLUMNS ": expected image,mask,output,z,epsilon,connectivity,algorithm"
+#define MSG_ERR_MANIFEST_NUMBERS ": invalid z, epsilon, connectivity or algorithm"
+#define MSG_ERR_JOB "Error: Batch job "
+#define MSG_ERR_JOB_OPEN_IMAGE "could not open the image file"
+#define MSG_ERR_JOB_OPEN_MASK "could not open the mask image file"
+#define MSG_ERR_JOB_IMAGE_SIZE "images have different sizes"
+#define MSG_ERR_JOB_SAVE_IMAGE "could not save the filled image"
+#define MSG_ERR_JOB_FILL "could not fill the image: "
+
+namespace {
+
+/**
+ * @brief Removes the spaces around a manifest field.
+ */
+std::string Trim (const std::string &field)
+{
+  std::size_t begin = field.find_first_not_of (" \t\r");
+  if (begin == std::string::npos) return std::string ();
+  std::size_t end = field.find_last_not_of (" \t\r");
+  return field.substr (begin, end - begin + 1);
+}
+
+/**
+ * @brief Parses the numbers of a manifest row into a job, with the checks of
+ * the command line arguments.
+ */
+bool ParseJobNumbers (const std::vector<std::string> &fields, BatchJob &job)
+{
+  char *endPtrZ;
+  char *endPtrE;
+  char *endPtrC;
+  char *endPtrA;
+  job.z = (int) std::strtol (fields[3].c_str (), &endPtrZ, 10);
+  job.epsilon = std::strtod (fields[4].c_str (), &endPtrE);
+  job.connectivity = (int) std::strtol (fields[5].c_str (), &endPtrC, 10);
+  job.algorithmType = (int) std::strtol (fields[6].c_str (), &endPtrA, 10);
+
+  for (int i = 3; i < MANIFEST_COLUMNS_AMOUNT; ++i)
+    {
+      if (fields[i].empty ()) return false;
+    }
+  if (*endPtrZ != '\0' || *endPtrE != '\0' || *endPtrC != '\0'
+      || *endPtrA != '\0')
+    return false;
+
+  return job.epsilon > 0
+         && (job.connectivity == CONNECTIVITY_OPTION_1
+             || job.connectivity == CONNECTIVITY_OPTION_2)
+         && job.algorithmType >= ALGORITHM_OPTION_AUTO
+         && job.algorithmType <= ALGORITHM_OPTION_FIVE;
+}
+
+/**
+ * @brief Returns the key of the plan of a job: jobs with the same key fill
+ * the same holes with the same parameters.
+ */
+std::string GetPlanKey (const BatchJob &job)
+{
+  std::ostringstream key;
+  key.precision (17);
+  key << job.z << MANIFEST_SEPARATOR << job.epsilon << MANIFEST_SEPARATOR
+      << job.connectivity << MANIFEST_SEPARATOR << job.algorithmType
+      << MANIFEST_SEPARATOR << job.maskPath;
+  return key.str ();
+}
+
+}
+
+BatchPipeline::BatchPipeline (const int fill_workers, const int filler_threads,
+                              const bool color,
+                              const FillerSetupType &filler_setup)
+    : fillWorkers_ (fill_workers), fillerThreads_ (filler_threads),
+      color_ (color), fillerSetup_ (filler_setup), jobs_ (nullptr),
+      nextJob_ (0), failedJobs_ (0)
+{}
+
+bool BatchPipeline::ReadManifest (const std::string &path,
+                                  std::vector<BatchJob> &jobs)
+{
+  std::ifstream manifest (path);
+  if (!manifest)
+    {
+      std::cerr << MSG_ERR_OPEN_MANIFEST << path << std::endl;
+      return false;
+    }
+
+  bool valid = true;
+  std::string line;
+  for (int row = 1; std::getline (manifest, line); ++row)
+    {
+      line = Trim (line);
+      if (line.empty () || line[0] == MANIFEST_COMMENT) continue;
+
+      std::vector<std::string> fields;
+      std::stringstream lineStream (line);
+      std::string field;
+      while (std::getline (lineStream, field, MANIFEST_SEPARATOR))
+        {
+          fields.push_back (Trim (field));
+        }
+
+      if (fields.size () != MANIFEST_COLUMNS_AMOUNT)
+        {
+          std::cerr << MSG_ERR_MANIFEST_ROW << row << MSG_ERR_MANIFEST_COLUMNS
+                    << std::endl;
+          valid = false;
+          continue;
+        }
+
+      BatchJob job;
+      job.imagePath = fields[0];
+      job.maskPath = fields[1];
+      job.outputPath = fields[2];
+      if (!ParseJobNumbers (fields, job))
+        {
+          std::cerr << MSG_ERR_MANIFEST_ROW << row << MSG_ERR_MANIFEST_NUMBERS
+                    << std::endl;
+          valid = false;
+          continue;
+        }
+
+      jobs.push_back (job);
+    }
+
+  return valid;
+}
+
+std::size_t BatchPipeline::Run (const std::vector<BatchJob> &jobs)
+{
+  jobs_ = &jobs;
+  nextJob_ = 0;
+  failedJobs_ = 0;
+  for (const BatchJob &job : jobs)
+    {
+      planUses_[GetPlanKey (job)]++;
+    }
+
+  BoundedQueue<WorkItem> decodedQueue (BATCH_QUEUE_CAPACITY);
+  BoundedQueue<WorkItem> maskedQueue (BATCH_QUEUE_CAPACITY);
+  BoundedQueue<WorkItem> filledQueue (BATCH_QUEUE_CAPACITY);
+
+  std::vector<std::thread> decodeWorkers;
+  std::vector<std::thread> maskWorkers;
+  std::vector<std::thread> fillWorkers;
+  std::vector<std::thread> encodeWorkers;
+  for (int i = 0; i < BATCH_DECODE_WORKERS; ++i)
+    {
+      decodeWorkers.emplace_back (&BatchPipeline::DecodeStage, this,
+                                  std::ref (decodedQueue));
+    }
+  for (int i = 0; i < BATCH_MASK_WORKERS; ++i)
+    {
+      maskWorkers.emplace_back (&BatchPipeline::MaskStage, this,
+                                std::ref (decodedQueue),
+                                std::ref (maskedQueue));
+    }
+  for (int i = 0; i < std::max (fillWorkers_, 1); ++i)
+    {
+      fillWorkers.emplace_back (&BatchPipeline::FillStage, this,
+                                std::ref (maskedQueue),
+                                std::ref (filledQueue));
+    }
+  for (int i = 0; i < BATCH_ENCODE_WORKERS; ++i)
+    {
+      encodeWorkers.emplace_back (&BatchPipeline::EncodeStage, this,
+                                  std::ref (filledQueue));
+    }
+
+  // A stage is done once all its workers are, and then the next stage only
+  // has to drain its queue.
+  for (std::thread &worker : decodeWorkers) worker.join ();
+  decodedQueue.Close ();
+  for (std::thread &worker : maskWorkers) worker.join ();
+  maskedQueue.Close ();
+  for (std::thread &worker : fillWorkers) worker.join ();
+  filledQueue.Close ();
+  for (std::thread &worker : encodeWorkers) worker.join ();
+
+  // Jobs that failed before the fill stage leave their plans behind.
+  plans_.clear ();
+  planUses_.clear ();
+  jobs_ = nullptr;
+  return failedJobs_;
+}
+
+void BatchPipeline::DecodeStage (BoundedQueue<WorkItem> &output)
+{
+  for (std::size_t jobIndex = nextJob_++; jobIndex < jobs_->size ();
+       jobIndex = nextJob_++)
+    {
+      const BatchJob &job = (*jobs_)[jobIndex];
+      WorkItem item;
+      item.jobIndex = jobIndex;
+      item.image = imread (job.imagePath, IMREAD_COLOR);
+      if (item.image.empty ())
+        {
+          ReportFailure (jobIndex, MSG_ERR_JOB_OPEN_IMAGE);
+          continue;
+        }
+
+      item.mask = imread (job.maskPath, IMREAD_GRAYSCALE);
+      if (item.mask.empty ())
+        {
+          ReportFailure (jobIndex, MSG_ERR_JOB_OPEN_MASK);
+          continue;
+        }
+
+      if (item.image.size () != item.mask.size ())
+        {
+          ReportFailure (jobIndex, MSG_ERR_JOB_IMAGE_SIZE);
+          continue;
+        }
+
+      output.Push (std::move (item));
+    }
+}
+
+void BatchPipeline::MaskStage (BoundedQueue<WorkItem> &input,
+                               BoundedQueue<WorkItem> &output)
+{
+  WorkItem item;
+  while (input.Pop (item))
+    {
+      item.image = color_ ? ImageMasker::ApplyMaskColor (item.image, item.mask,
+                                                          fillerThreads_)
+                          : ImageMasker::ApplyMask (item.image, item.mask,
+                                                    fillerThreads_);
+      item.mask.release ();
+      output.Push (std::move (item));
+    }
+}
+
+void BatchPipeline::FillStage (BoundedQueue<WorkItem> &input,
+                               BoundedQueue<WorkItem> &output)
+{
+  WorkItem item;
+  while (input.Pop (item))
+    {
+      const BatchJob &job = (*jobs_)[item.jobIndex];
+      // An exception, e.g. a failed allocation for a huge hole, fails the
+      // job but not the batch.
+      try
+        {
+          HoleFiller holeFiller (job.z, job.epsilon, job.connectivity,
+                                 job.algorithmType,
+                                 &MyWeightFunction::GetWeight, fillerThreads_);
+          if (fillerSetup_) fillerSetup_ (holeFiller);
+
+          std::shared_ptr<const FillPlan> plan =
+              AcquirePlan (job, holeFiller, item.image);
+          item.image = plan ? holeFiller.FillImage (item.image, *plan)
+                            : holeFiller.FillImage (item.image);
+        }
+      catch (const std::exception &e)
+        {
+          ReportFailure (item.jobIndex,
+                         std::string (MSG_ERR_JOB_FILL) + e.what ());
+          continue;
+        }
+      output.Push (std::move (item));
+    }
+}
+
+std::shared_ptr<const FillPlan>
+BatchPipeline::AcquirePlan (const BatchJob &job, HoleFiller &holeFiller,
+                            const Mat &maskedImage)
+{
+  std::string key = GetPlanKey (job);
+  std::shared_ptr<const FillPlan> plan;
+  {
+    std::lock_guard<std::mutex> lock (plansMutex_);
+    std::size_t &uses = planUses_[key];
+    if (uses <= 1)
+      {
+        // The last job of the mask, or its only one.
+        plan = plans_[key];
+        plans_.erase (key);
+        planUses_.erase (key);
+        return plan;
+      }
+    uses--;
+    plan = plans_[key];
+  }
+  if (plan) return plan;
+
+  // Made outside the lock, so other masks are not held up. Two jobs of the
+  // same mask may both make it, and then the first one is kept.
+  plan = std::make_shared<const FillPlan> (holeFiller.CreatePlan (maskedImage));
+  std::lock_guard<std::mutex> lock (plansMutex_);
+  std::shared_ptr<const FillPlan> &cachedPlan = plans_[key];
+  if (!cachedPlan && planUses_.count (key)) cachedPlan = plan;
+  return plan;
+}
+
+void BatchPipeline::EncodeStage (BoundedQueue<WorkItem> &input)
+{
+  WorkItem item;
+  while (input.Pop (item))
+    {
+      bool saved;
+      try
+        {
+          saved = imwrite ((*jobs_)[item.jobIndex].outputPath, item.image);
+        }
+      catch (const cv::Exception &)
+        {
+          // E.g. an output path without a known image extension.
+          saved = false;
+        }
+
+      if (!saved)
+        {
+          ReportFailure (item.jobIndex, MSG_ERR_JOB_SAVE_IMAGE);
+        }
+    }
+}
+
+void BatchPipeline::ReportFailure (const std::size_t jobIndex,
+                                   const std::string &message)
+{
+  failedJobs_++;
+
+  const BatchJob &job = (*jobs_)[jobIndex];
+  std::ostringstream report;
+  report << MSG_ERR_JOB << (jobIndex + 1) << " (" << job.imagePath << "): "
+         << message << "\n";
+  std::cerr << report.str ();
+}
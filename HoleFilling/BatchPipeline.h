@@ -0,0 +1,150 @@
+#ifndef BATCH_PIPELINE_H
+#define BATCH_PIPELINE_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "HoleFiller.h"
+
+#define BATCH_QUEUE_CAPACITY 8
+#define BATCH_DECODE_WORKERS 2
+#define BATCH_MASK_WORKERS 1
+#define BATCH_ENCODE_WORKERS 2
+
+#define MANIFEST_COLUMNS_AMOUNT 7
+#define MANIFEST_SEPARATOR ','
+#define MANIFEST_COMMENT '#'
+
+/**
+ * @brief A row of a batch manifest: the paths of an image, of its mask and
+ * of the filled output, and the parameters to fill it with.
+ */
+struct BatchJob {
+  std::string imagePath;
+  std::string maskPath;
+  std::string outputPath;
+  int z;
+  double epsilon;
+  int connectivity;
+  int algorithmType;
+};
+
+/**
+ * @brief Alias for a function applying settings to the HoleFiller of every
+ * job, e.g. HoleFiller::SetConvergenceCriteria.
+ */
+typedef std::function<void (HoleFiller &)> FillerSetupType;
+
+/**
+ * BatchPipeline fills the images of a batch manifest. Decoding, masking,
+ * filling and encoding run as separate stages, each on its own worker
+ * threads, connected by BoundedQueues: reading and writing files overlaps
+ * the filling, the throughput is that of the slowest stage, and at most a
+ * few images per stage are in memory at once.
+ *
+ * Jobs with the same mask and parameters share a FillPlan, made by the first
+ * of them to be filled and released after the last one.
+ */
+class BatchPipeline {
+ public:
+  /**
+   * @brief Constructor for the BatchPipeline class.
+   *
+   * @param fill_workers The number of jobs filled concurrently.
+   * @param filler_threads The thread count of the HoleFiller of every job.
+   * @param color Fill the images in color, see ImageMasker::ApplyMaskColor.
+   * @param filler_setup Applied to the HoleFiller of every job.
+   */
+  BatchPipeline (int fill_workers, int filler_threads, bool color,
+                 const FillerSetupType &filler_setup);
+
+  /**
+   * @brief Reads a manifest, a text file with a row per job:
+   * `image,mask,output,z,epsilon,connectivity,algorithm`. Empty rows and
+   * rows starting with MANIFEST_COMMENT are skipped. Errors are printed to
+   * the standard error stream with their row number.
+   *
+   * @param path The path of the manifest.
+   * @param jobs Output for the jobs.
+   *
+   * @return True if all the rows are valid.
+   */
+  static bool ReadManifest (const std::string &path,
+                            std::vector<BatchJob> &jobs);
+
+  /**
+   * @brief Fills the images of all the jobs. A job that fails is reported to
+   * the standard error stream and does not stop the others.
+   *
+   * @return The number of jobs that failed.
+   */
+  std::size_t Run (const std::vector<BatchJob> &jobs);
+
+ private:
+  /**
+   * @brief A job on its way through the stages.
+   */
+  struct WorkItem {
+    std::size_t jobIndex;
+    Mat image;
+    Mat mask;
+  };
+
+  int fillWorkers_;
+  int fillerThreads_;
+  bool color_;
+  FillerSetupType fillerSetup_;
+
+  const std::vector<BatchJob> *jobs_;
+  std::atomic<std::size_t> nextJob_;
+  std::atomic<std::size_t> failedJobs_;
+
+  // The plans of the masks used by more than one job, with the number of
+  // jobs still to be filled with them.
+  std::mutex plansMutex_;
+  std::map<std::string, std::shared_ptr<const FillPlan>> plans_;
+  std::map<std::string, std::size_t> planUses_;
+
+  /**
+   * @brief Reads the image and the mask of the next jobs.
+   */
+  void DecodeStage (BoundedQueue<WorkItem> &output);
+
+  /**
+   * @brief Marks the holes of decoded images with their masks.
+   */
+  void MaskStage (BoundedQueue<WorkItem> &input,
+                  BoundedQueue<WorkItem> &output);
+
+  /**
+   * @brief Fills the holes of masked images.
+   */
+  void FillStage (BoundedQueue<WorkItem> &input,
+                  BoundedQueue<WorkItem> &output);
+
+  /**
+   * @brief Returns the plan of the mask of a job, made from its masked image
+   * if no other job made it yet, or nullptr if no other job uses the mask.
+   */
+  std::shared_ptr<const FillPlan> AcquirePlan (const BatchJob &job,
+                                               HoleFiller &holeFiller,
+                                               const Mat &maskedImage);
+
+  /**
+   * @brief Writes filled images to their output paths.
+   */
+  void EncodeStage (BoundedQueue<WorkItem> &input);
+
+  /**
+   * @brief Reports a failed job.
+   */
+  void ReportFailure (std::size_t jobIndex, const std::string &message);
+};
+
+#endif // BATCH_PIPELINE_H
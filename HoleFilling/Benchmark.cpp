@@ -0,0 +1,259 @@
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HoleFiller.h"
+#include "ImageMasker.h"
+#include "MaskGenerator.h"
+#include "MyWeightFunction.h"
+
+#define BENCHMARK_SEED 20231
+#define BENCHMARK_EPSILON 0.01
+#define DEFAULT_REPEATS_AMOUNT 3
+
+#define OPTION_QUICK "--quick"
+#define OPTION_THREADS "--threads="
+#define OPTION_REPEATS "--repeats="
+#define OPTION_ALGORITHM "--algorithm="
+#define OPTION_SHAPE "--shape="
+
+#define MSG_USAGE \
+"Usage: HoleFillingBenchmark [--quick] [--threads=N] [--repeats=N]\n\
+  [--algorithm=A] [--shape=S]\n\
+- --quick Only the smallest size, hole fraction and z\n\
+- --threads=N Measure 1, 2, 4, ... up to N threads (default: all cores)\n\
+- --repeats=N Keep the fastest of N fills of every case (default 3)\n\
+- --algorithm=A Only algorithm A (1 to 5)\n\
+- --shape=S Only masks of shape S (rectangle, blob, scratches, small-holes\n\
+  or border)"
+
+#define CSV_HEADER \
+"shape,size,hole_fraction,connectivity,z,algorithm,threads,hole_pixels,\
+seconds,hole_pixels_per_second,speedup"
+#define CSV_SEPARATOR ','
+
+namespace {
+
+const int IMAGE_SIZES[] = {256, 512, 1024};
+const double HOLE_FRACTIONS[] = {0.005, 0.02, 0.08};
+const int CONNECTIVITIES[] = {CONNECTIVITY_OPTION_1, CONNECTIVITY_OPTION_2};
+const int Z_VALUES[] = {2, 4};
+const int ALGORITHMS[] = {ALGORITHM_OPTION_ONE, ALGORITHM_OPTION_TWO,
+                          ALGORITHM_OPTION_THREE, ALGORITHM_OPTION_FOUR,
+                          ALGORITHM_OPTION_FIVE};
+
+/**
+ * @brief Values of the command-line arguments.
+ */
+struct BenchmarkOptions {
+  bool quick = false;
+  int maxThreads = (int) std::max (std::thread::hardware_concurrency (), 1u);
+  int repeats = DEFAULT_REPEATS_AMOUNT;
+  int algorithm = ALGORITHM_OPTION_AUTO;
+  int shape = -1;
+};
+
+/**
+ * @brief Parses a positive integer following an option prefix.
+ */
+bool ParsePositiveInteger (const char *value, int &result)
+{
+  char *endPtr;
+  result = (int) std::strtol (value, &endPtr, 10);
+  return *value != '\0' && *endPtr == '\0' && result > 0;
+}
+
+bool ParseOptions (int argc, char **argv, BenchmarkOptions &options)
+{
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string argument (argv[i]);
+      bool valid = true;
+
+      if (argument == OPTION_QUICK)
+        {
+          options.quick = true;
+        }
+      else if (argument.compare (0, std::strlen (OPTION_THREADS),
+                                 OPTION_THREADS) == 0)
+        {
+          valid = ParsePositiveInteger (argv[i] + std::strlen (OPTION_THREADS),
+                                        options.maxThreads);
+        }
+      else if (argument.compare (0, std::strlen (OPTION_REPEATS),
+                                 OPTION_REPEATS) == 0)
+        {
+          valid = ParsePositiveInteger (argv[i] + std::strlen (OPTION_REPEATS),
+                                        options.repeats);
+        }
+      else if (argument.compare (0, std::strlen (OPTION_ALGORITHM),
+                                 OPTION_ALGORITHM) == 0)
+        {
+          valid = ParsePositiveInteger (
+              argv[i] + std::strlen (OPTION_ALGORITHM), options.algorithm)
+                  && options.algorithm <= ALGORITHM_OPTION_FIVE;
+        }
+      else if (argument.compare (0, std::strlen (OPTION_SHAPE),
+                                 OPTION_SHAPE) == 0)
+        {
+          std::string name = argument.substr (std::strlen (OPTION_SHAPE));
+          for (int shape = 0; shape < MASK_SHAPES_AMOUNT; ++shape)
+            {
+              if (name == MaskGenerator::GetShapeName (shape))
+                {
+                  options.shape = shape;
+                }
+            }
+          valid = options.shape >= 0;
+        }
+      else
+        {
+          valid = false;
+        }
+
+      if (!valid)
+        {
+          std::cerr << MSG_USAGE << std::endl;
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/**
+ * @brief Returns the thread counts to measure: the powers of 2 below the
+ * maximum, and the maximum.
+ */
+std::vector<int> GetThreadCounts (const int maxThreads)
+{
+  std::vector<int> threadCounts;
+  for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+      threadCounts.push_back (threads);
+    }
+  threadCounts.push_back (maxThreads);
+  return threadCounts;
+}
+
+/**
+ * @brief Fills an image several times and returns the fastest time, in
+ * seconds.
+ */
+double MeasureFill (HoleFiller &holeFiller, const Mat &maskedImage,
+                    const int repeats)
+{
+  double bestSeconds = 0;
+  for (int i = 0; i < repeats; ++i)
+    {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now ();
+      Mat filledImage = holeFiller.FillImage (maskedImage);
+      std::chrono::duration<double> seconds =
+          std::chrono::steady_clock::now () - start;
+
+      if (i == 0 || seconds.count () < bestSeconds)
+        {
+          bestSeconds = seconds.count ();
+        }
+    }
+
+  return bestSeconds;
+}
+
+}
+
+/**
+ * The benchmark fills synthetic images with the masks of MaskGenerator, for
+ * every image size, hole fraction, mask shape, connectivity, z, algorithm
+ * and thread count, and prints a CSV row per case: the fastest time of the
+ * fills, the hole pixels filled per second, and the speedup over a single
+ * thread. The images and masks only depend on BENCHMARK_SEED, so runs on
+ * different builds measure the same work.
+ */
+int main (int argc, char **argv)
+{
+  BenchmarkOptions options;
+  if (!ParseOptions (argc, argv, options)) return 1;
+
+  std::vector<int> sizes (std::begin (IMAGE_SIZES), std::end (IMAGE_SIZES));
+  std::vector<double> holeFractions (std::begin (HOLE_FRACTIONS),
+                                     std::end (HOLE_FRACTIONS));
+  std::vector<int> zValues (std::begin (Z_VALUES), std::end (Z_VALUES));
+  if (options.quick)
+    {
+      sizes.resize (1);
+      holeFractions.resize (1);
+      zValues.resize (1);
+    }
+  std::vector<int> threadCounts = GetThreadCounts (options.maxThreads);
+
+  std::cout << CSV_HEADER << std::endl;
+  for (int size : sizes)
+    {
+      MaskGenerator imageGenerator (BENCHMARK_SEED);
+      Mat image = imageGenerator.GenerateImage (size, size);
+
+      for (double holeFraction : holeFractions)
+        {
+          for (int shape = 0; shape < MASK_SHAPES_AMOUNT; ++shape)
+            {
+              if (options.shape >= 0 && shape != options.shape) continue;
+
+              MaskGenerator maskGenerator (BENCHMARK_SEED + shape);
+              Mat mask = maskGenerator.GenerateMask (shape, size, size,
+                                                     holeFraction);
+              int holePixels = MaskGenerator::CountHolePixels (mask);
+              Mat maskedImage = ImageMasker::ApplyMask (image, mask);
+
+              for (int connectivity : CONNECTIVITIES)
+                {
+                  for (int z : zValues)
+                    {
+                      for (int algorithm : ALGORITHMS)
+                        {
+                          if (options.algorithm != ALGORITHM_OPTION_AUTO
+                              && algorithm != options.algorithm)
+                            continue;
+
+                          double singleThreadSeconds = 0;
+                          for (int threads : threadCounts)
+                            {
+                              HoleFiller holeFiller (
+                                  z, BENCHMARK_EPSILON, connectivity,
+                                  algorithm, &MyWeightFunction::GetWeight,
+                                  threads);
+                              double seconds = MeasureFill (holeFiller,
+                                                            maskedImage,
+                                                            options.repeats);
+                              if (threads == 1) singleThreadSeconds = seconds;
+
+                              std::cout
+                                  << MaskGenerator::GetShapeName (shape)
+                                  << CSV_SEPARATOR << size << CSV_SEPARATOR
+                                  << holeFraction << CSV_SEPARATOR
+                                  << connectivity << CSV_SEPARATOR << z
+                                  << CSV_SEPARATOR << algorithm
+                                  << CSV_SEPARATOR << threads << CSV_SEPARATOR
+                                  << holePixels << CSV_SEPARATOR << seconds
+                                  << CSV_SEPARATOR << holePixels / seconds
+                                  << CSV_SEPARATOR
+                                  << singleThreadSeconds / seconds
+                                  << std::endl;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+  return 0;
+}
@@ -0,0 +1,161 @@
+#include "BoundaryQuadTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Nodes with at most this many boundary pixels are not split.
+#define QUAD_TREE_LEAF_SIZE 8
+#define NO_CHILD -1
+
+BoundaryQuadTree::BoundaryQuadTree (const std::vector<Pixel> &coordinates,
+                                    const std::vector<float> &values,
+                                    const int channels)
+    : channels_ (channels), coordinates_ (coordinates), values_ (values)
+{
+  if (!coordinates_.empty ())
+    {
+      BuildNode (0, (int) coordinates_.size ());
+    }
+}
+
+int BoundaryQuadTree::BuildNode (const int begin, const int end)
+{
+  int minX = coordinates_[begin].first;
+  int maxX = minX;
+  int minY = coordinates_[begin].second;
+  int maxY = minY;
+  double sumX = 0;
+  double sumY = 0;
+  int nodeIndex = (int) nodes_.size ();
+  valueSums_.resize (valueSums_.size () + channels_, 0);
+
+  for (int i = begin; i < end; ++i)
+    {
+      minX = std::min (minX, coordinates_[i].first);
+      maxX = std::max (maxX, coordinates_[i].first);
+      minY = std::min (minY, coordinates_[i].second);
+      maxY = std::max (maxY, coordinates_[i].second);
+      sumX += coordinates_[i].first;
+      sumY += coordinates_[i].second;
+      for (int c = 0; c < channels_; ++c)
+        {
+          valueSums_[nodeIndex * channels_ + c] += values_[i * channels_ + c];
+        }
+    }
+
+  int count = end - begin;
+  Node node;
+  node.size = std::max (maxX - minX, maxY - minY) + 1;
+  node.centroidX = sumX / count;
+  node.centroidY = sumY / count;
+  node.begin = begin;
+  node.end = end;
+  std::fill (node.children, node.children + 4, NO_CHILD);
+  nodes_.push_back (node);
+
+  if (count <= QUAD_TREE_LEAF_SIZE || node.size == 1) return nodeIndex;
+
+  // Split the pixels into the four quadrants of the node.
+  int midX = minX + (maxX - minX) / 2;
+  int midY = minY + (maxY - minY) / 2;
+  int bounds[5];
+  bounds[0] = begin;
+  bounds[4] = end;
+
+  bounds[2] = Partition (begin, end, true, midX);
+  bounds[1] = Partition (begin, bounds[2], false, midY);
+  bounds[3] = Partition (bounds[2], end, false, midY);
+
+  for (int i = 0; i < 4; ++i)
+    {
+      if (bounds[i] < bounds[i + 1])
+        {
+          int child = BuildNode (bounds[i], bounds[i + 1]);
+          nodes_[nodeIndex].children[i] = child;
+        }
+    }
+
+  return nodeIndex;
+}
+
+int BoundaryQuadTree::Partition (const int begin, const int end,
+                                 const bool byX, const int split)
+{
+  int lowEnd = begin;
+  for (int i = begin; i < end; ++i)
+    {
+      int coordinate = byX ? coordinates_[i].first : coordinates_[i].second;
+      if (coordinate <= split)
+        {
+          std::swap (coordinates_[i], coordinates_[lowEnd]);
+          std::swap_ranges (values_.begin () + i * channels_,
+                            values_.begin () + (i + 1) * channels_,
+                            values_.begin () + lowEnd * channels_);
+          lowEnd++;
+        }
+    }
+  return lowEnd;
+}
+
+int BoundaryQuadTree::Accumulate (const Pixel &holePixel,
+                                  const WeightFunctionType &weightFunc,
+                                  const int z, const double epsilon,
+                                  const double theta, double *dividendSums,
+                                  double &divisorSum) const
+{
+  int weightsAmount = 0;
+  if (nodes_.empty ()) return weightsAmount;
+
+  std::vector<int> stack (1, 0);
+  while (!stack.empty ())
+    {
+      int nodeIndex = stack.back ();
+      const Node &node = nodes_[nodeIndex];
+      stack.pop_back ();
+
+      double dx = node.centroidX - holePixel.first;
+      double dy = node.centroidY - holePixel.second;
+      double distance = std::sqrt ((dx * dx) + (dy * dy));
+
+      if (node.size < theta * distance)
+        {
+          Pixel centroid ((int) std::lround (node.centroidX),
+                          (int) std::lround (node.centroidY));
+          double currWeightValue =
+              weightFunc (holePixel, centroid, z, epsilon);
+          for (int c = 0; c < channels_; ++c)
+            {
+              dividendSums[c] += (valueSums_[nodeIndex * channels_ + c]
+                                  * currWeightValue);
+            }
+          divisorSum += ((node.end - node.begin) * currWeightValue);
+          weightsAmount++;
+          continue;
+        }
+
+      if (node.children[0] == NO_CHILD && node.children[1] == NO_CHILD
+          && node.children[2] == NO_CHILD && node.children[3] == NO_CHILD)
+        {
+          for (int i = node.begin; i < node.end; ++i)
+            {
+              double currWeightValue =
+                  weightFunc (holePixel, coordinates_[i], z, epsilon);
+              for (int c = 0; c < channels_; ++c)
+                {
+                  dividendSums[c] += (values_[i * channels_ + c]
+                                      * currWeightValue);
+                }
+              divisorSum += currWeightValue;
+            }
+          weightsAmount += node.end - node.begin;
+          continue;
+        }
+
+      for (int child : node.children)
+        {
+          if (child != NO_CHILD) stack.push_back (child);
+        }
+    }
+
+  return weightsAmount;
+}
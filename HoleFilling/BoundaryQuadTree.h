@@ -0,0 +1,86 @@
+#ifndef BOUNDARY_QUAD_TREE_H
+#define BOUNDARY_QUAD_TREE_H
+
+#include <vector>
+
+#include "WeightFunction.h"
+
+/**
+ * BoundaryQuadTree approximates the regular algorithm sums of a hole pixel in
+ * the Barnes-Hut way. The boundary pixels are stored in a quadtree whose
+ * nodes keep the amount of boundary pixels (their weight mass), the sum of
+ * their values of every channel and their centroid. A node that is far enough from the hole
+ * pixel contributes as a single pixel at its centroid, so a hole pixel
+ * visits about O(log B) nodes instead of all the B boundary pixels.
+ */
+class BoundaryQuadTree {
+ public:
+  /**
+   * @brief Builds the quadtree over the boundary pixels.
+   *
+   * @param coordinates The coordinates of the boundary pixels.
+   * @param values The values of every channel of the boundary pixels, one
+   * after the other.
+   * @param channels The number of channels of the values.
+   */
+  BoundaryQuadTree (const std::vector<Pixel> &coordinates,
+                    const std::vector<float> &values, int channels = 1);
+
+  /**
+   * @brief Adds the (approximate) weighted boundary values and weights of all
+   * the boundary pixels for a single hole pixel.
+   *
+   * A node of size s at distance d from the hole pixel is used as a whole
+   * when s < theta * d, where theta is the opening angle.
+   *
+   * @param holePixel The coordinates of the hole pixel.
+   * @param weightFunc The weight function.
+   * @param z The z of the weight function.
+   * @param epsilon The epsilon of the weight function.
+   * @param theta The opening angle, 0 gives the exact sums.
+   * @param dividendSums The sums of the weighted values of every channel.
+   * @param divisorSum A reference to the sum of the weights.
+   *
+   * @return The number of weights computed.
+   */
+  int Accumulate (const Pixel &holePixel,
+                   const WeightFunctionType &weightFunc, int z,
+                   double epsilon, double theta, double *dividendSums,
+                   double &divisorSum) const;
+
+ private:
+  /**
+   * @brief A quadtree node covering the boundary pixels [begin, end) of the
+   * reordered `coordinates_` and `values_`. Its value sums are in
+   * `valueSums_`, at the node index times the channels.
+   */
+  struct Node {
+    int size;
+    double centroidX;
+    double centroidY;
+    int begin;
+    int end;
+    int children[4];
+  };
+
+  int channels_;
+  std::vector<Pixel> coordinates_;
+  std::vector<float> values_;
+  std::vector<Node> nodes_;
+  std::vector<double> valueSums_;
+
+  /**
+   * @brief Builds the subtree of the boundary pixels [begin, end) and
+   * returns the index of its root node.
+   */
+  int BuildNode (int begin, int end);
+
+  /**
+   * @brief Reorders the boundary pixels [begin, end) so the ones with an x
+   * (or y) coordinate of at most split come first, and returns where the
+   * others start.
+   */
+  int Partition (int begin, int end, bool byX, int split);
+};
+
+#endif // BOUNDARY_QUAD_TREE_H
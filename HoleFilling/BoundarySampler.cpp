@@ -0,0 +1,84 @@
+#include "BoundarySampler.h"
+
+#include <cmath>
+
+BoundarySampler::BoundarySampler (const std::vector<Pixel> &coordinates,
+                                  const std::vector<float> &values,
+                                  const int channels, const int sampleBudget)
+    : channels_ (channels), sampleBudget_ (sampleBudget), cellSize_ (1)
+{
+  if (coordinates.empty ()) return;
+
+  // A boundary of B pixels is a curve, so cells of side sqrt (B) hold about
+  // sqrt (B) of its pixels each. A hole pixel then weighs about sqrt (B)
+  // cells and sums the few cells near it exactly, both in O(sqrt (B)).
+  cellSize_ = std::max (
+      (int) std::lround (std::sqrt ((double) coordinates.size ())), 1);
+
+  int minX = coordinates[0].first;
+  int minY = coordinates[0].second;
+  int maxY = minY;
+  for (const Pixel &pixel : coordinates)
+    {
+      minX = std::min (minX, pixel.first);
+      minY = std::min (minY, pixel.second);
+      maxY = std::max (maxY, pixel.second);
+    }
+  long long gridCols = (maxY - minY) / cellSize_ + 1;
+
+  // Sort the pixels by cell, keeping their row-major order in a cell. Most
+  // cells of the bounding box are empty, so the grid is not allocated.
+  std::vector<long long> pixelCells (coordinates.size ());
+  std::vector<int> order (coordinates.size ());
+  for (std::size_t i = 0; i < coordinates.size (); ++i)
+    {
+      pixelCells[i] = (coordinates[i].first - minX) / cellSize_ * gridCols
+                      + (coordinates[i].second - minY) / cellSize_;
+      order[i] = (int) i;
+    }
+  std::stable_sort (order.begin (), order.end (),
+                    [&pixelCells] (int first, int second)
+                    {
+                      return pixelCells[first] < pixelCells[second];
+                    });
+
+  coordinates_.resize (coordinates.size ());
+  values_.resize (values.size ());
+  for (std::size_t i = 0; i < order.size (); ++i)
+    {
+      coordinates_[i] = coordinates[order[i]];
+      std::copy (values.data () + order[i] * channels_,
+                 values.data () + (order[i] + 1) * channels_,
+                 values_.data () + i * channels_);
+    }
+
+  int end = 0;
+  while (end < (int) order.size ())
+    {
+      Cell cell;
+      cell.begin = end;
+      while (end < (int) order.size ()
+             && pixelCells[order[end]] == pixelCells[order[cell.begin]])
+        {
+          ++end;
+        }
+      cell.end = end;
+      cell.minX = coordinates_[cell.begin].first;
+      cell.maxX = coordinates_[cell.end - 1].first;
+      cell.minY = coordinates_[cell.begin].second;
+      cell.maxY = cell.minY;
+      double sumX = 0;
+      double sumY = 0;
+      for (int j = cell.begin; j < cell.end; ++j)
+        {
+          cell.minY = std::min (cell.minY, coordinates_[j].second);
+          cell.maxY = std::max (cell.maxY, coordinates_[j].second);
+          sumX += coordinates_[j].first;
+          sumY += coordinates_[j].second;
+        }
+      int count = cell.end - cell.begin;
+      cell.center = Pixel ((int) std::lround (sumX / count),
+                           (int) std::lround (sumY / count));
+      cells_.push_back (cell);
+    }
+}
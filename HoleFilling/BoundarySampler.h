@@ -0,0 +1,256 @@
+#ifndef BOUNDARY_SAMPLER_H
+#define BOUNDARY_SAMPLER_H
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "ParallelFor.h"
+#include "WeightFunction.h"
+
+/**
+ * BoundarySampler estimates the regular algorithm sums of a hole pixel from
+ * a sample of the boundary pixels. The boundary pixels are bucketed into
+ * square cells. Cells near the hole pixel, whose weights differ the most
+ * from pixel to pixel, are summed exactly. Every far cell gets a share of
+ * the sample budget proportional to its estimated weight mass, and at least
+ * one sample. Its pixels are split into that many strata of consecutive
+ * pixels, and one pixel drawn from every stratum stands for the whole
+ * stratum. Both sums are thus unbiased, and their ratio, the filled value,
+ * has an error shrinking with the budget. The samples of a hole pixel only
+ * depend on its coordinates, so the fill is the same for any thread count.
+ */
+class BoundarySampler {
+ public:
+  /**
+   * @brief Buckets the boundary pixels into cells.
+   *
+   * @param coordinates The coordinates of the boundary pixels.
+   * @param values The values of every channel of the boundary pixels, one
+   * after the other.
+   * @param channels The number of channels of the values.
+   * @param sampleBudget The number of far boundary pixels to sample per
+   * hole pixel, positive.
+   */
+  BoundarySampler (const std::vector<Pixel> &coordinates,
+                   const std::vector<float> &values, int channels,
+                   int sampleBudget);
+
+  /**
+   * @brief Adds the estimated weighted boundary values and weights of all
+   * the boundary pixels for a single hole pixel.
+   *
+   * @tparam Channels The number of channels given to the constructor.
+   * @param holePixel The coordinates of the hole pixel.
+   * @param weight The weight of two pixels, called as weight (p1, p2).
+   * @param cellMasses Scratch space for the weight mass of every cell, kept
+   * between calls to save allocations.
+   * @param dividendSums The sums of the weighted values of every channel.
+   * @param divisorSum A reference to the sum of the weights.
+   *
+   * @return The number of weights computed.
+   */
+  template <int Channels, typename Weight>
+  int Accumulate (const Pixel &holePixel, const Weight &weight,
+                  std::vector<double> &cellMasses, double *dividendSums,
+                  double &divisorSum) const;
+
+  /**
+   * @brief Fills hole pixels with the ratio of their estimated sums, split
+   * between threads.
+   *
+   * @tparam Channels The number of channels given to the constructor.
+   * @param holePixels The coordinates of the hole pixels.
+   * @param weight The weight of two pixels, called as weight (p1, p2).
+   * @param threadCount The number of threads to use.
+   * @param filledImage The output image, with the channels of the values.
+   *
+   * @return The number of weights computed.
+   */
+  template <int Channels, typename Weight>
+  long long FillHolePixels (const std::vector<Pixel> &holePixels,
+                            const Weight &weight, int threadCount,
+                            cv::Mat &filledImage) const;
+
+ private:
+  /**
+   * @brief A cell covering the boundary pixels [begin, end) of the
+   * reordered `coordinates_` and `values_`.
+   */
+  struct Cell {
+    int begin;
+    int end;
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    // The centroid of the pixels, rounded, for the weight mass.
+    Pixel center;
+  };
+
+  int channels_;
+  int sampleBudget_;
+  int cellSize_;
+  std::vector<Pixel> coordinates_;
+  std::vector<float> values_;
+  std::vector<Cell> cells_;
+
+  /**
+   * @brief Returns the Chebyshev distance of a pixel to the bounding box of
+   * a cell, 0 inside it.
+   */
+  static int GetCellDistance (const Cell &cell, const Pixel &pixel);
+
+  /**
+   * @brief Returns the first state of the random numbers of a hole pixel.
+   */
+  static uint64_t GetSeed (const Pixel &holePixel);
+
+  /**
+   * @brief Returns a random integer in [0, range), advancing the state, with
+   * the SplitMix64 generator.
+   */
+  static int RandomIndex (uint64_t &state, int range);
+};
+
+inline int BoundarySampler::GetCellDistance (const Cell &cell, const Pixel &pixel)
+{
+  int dx = std::max (std::max (cell.minX - pixel.first,
+                               pixel.first - cell.maxX), 0);
+  int dy = std::max (std::max (cell.minY - pixel.second,
+                               pixel.second - cell.maxY), 0);
+  return std::max (dx, dy);
+}
+
+inline uint64_t BoundarySampler::GetSeed (const Pixel &holePixel)
+{
+  return ((uint64_t) (uint32_t) holePixel.first << 32)
+         | (uint32_t) holePixel.second;
+}
+
+inline int BoundarySampler::RandomIndex (uint64_t &state, const int range)
+{
+  state += 0x9E3779B97F4A7C15ULL;
+  uint64_t value = state;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  value ^= value >> 31;
+  return (int) (((value >> 32) * (uint64_t) range) >> 32);
+}
+
+template <int Channels, typename Weight>
+int BoundarySampler::Accumulate (const Pixel &holePixel, const Weight &weight,
+                                 std::vector<double> &cellMasses,
+                                 double *dividendSums,
+                                 double &divisorSum) const
+{
+  double sums[Channels] = {};
+  double weightSum = 0;
+  int weightsAmount = 0;
+  double farMass = 0;
+  cellMasses.assign (cells_.size (), 0);
+
+  // Cells within a cell size of the hole pixel are summed exactly, the
+  // others weighed at their centers for the budget.
+  for (std::size_t i = 0; i < cells_.size (); ++i)
+    {
+      const Cell &cell = cells_[i];
+      if (GetCellDistance (cell, holePixel) <= cellSize_)
+        {
+          for (int j = cell.begin; j < cell.end; ++j)
+            {
+              double pixelWeight = weight (holePixel, coordinates_[j]);
+              for (int c = 0; c < Channels; ++c)
+                {
+                  sums[c] += values_[j * Channels + c] * pixelWeight;
+                }
+              weightSum += pixelWeight;
+            }
+          weightsAmount += cell.end - cell.begin;
+          continue;
+        }
+
+      cellMasses[i] = (cell.end - cell.begin) * weight (holePixel,
+                                                        cell.center);
+      farMass += cellMasses[i];
+      ++weightsAmount;
+    }
+
+  uint64_t state = GetSeed (holePixel);
+  double samplesPerMass = farMass > 0 ? sampleBudget_ / farMass : 0;
+  for (std::size_t i = 0; i < cells_.size (); ++i)
+    {
+      if (cellMasses[i] <= 0) continue;
+
+      const Cell &cell = cells_[i];
+      int size = cell.end - cell.begin;
+      int samples = (int) (samplesPerMass * cellMasses[i] + 0.5);
+      samples = std::max (std::min (samples, size), 1);
+      weightsAmount += samples;
+
+      // One pixel of every stratum of about size / samples consecutive
+      // pixels stands for the stratum.
+      double stratumSize = (double) size / samples;
+      int first = 0;
+      for (int s = 1; s <= samples; ++s)
+        {
+          int last = (s == samples) ? size : (int) (s * stratumSize);
+          int index = cell.begin + first
+                      + RandomIndex (state, last - first);
+          double pixelWeight = (last - first)
+                               * weight (holePixel, coordinates_[index]);
+          for (int c = 0; c < Channels; ++c)
+            {
+              sums[c] += values_[index * Channels + c] * pixelWeight;
+            }
+          weightSum += pixelWeight;
+          first = last;
+        }
+    }
+
+  for (int c = 0; c < Channels; ++c)
+    {
+      dividendSums[c] += sums[c];
+    }
+  divisorSum += weightSum;
+  return weightsAmount;
+}
+
+template <int Channels, typename Weight>
+long long BoundarySampler::FillHolePixels (const std::vector<Pixel> &holePixels,
+                                           const Weight &weight,
+                                           const int threadCount,
+                                           cv::Mat &filledImage) const
+{
+  std::atomic<long long> weightsAmount (0);
+  ParallelFor (holePixels.size (), threadCount,
+               [&] (std::size_t begin, std::size_t end)
+               {
+                 std::vector<double> cellMasses;
+                 long long chunkWeights = 0;
+                 for (std::size_t i = begin; i < end; ++i)
+                   {
+                     const Pixel &holePixel = holePixels[i];
+                     double dividendSums[Channels] = {};
+                     double divisorSum = 0;
+                     chunkWeights += Accumulate<Channels> (
+                         holePixel, weight, cellMasses, dividendSums,
+                         divisorSum);
+
+                     float *filledPixel =
+                         filledImage.ptr<float> (holePixel.first)
+                         + holePixel.second * Channels;
+                     for (int c = 0; c < Channels; ++c)
+                       {
+                         filledPixel[c] = (dividendSums[c] / divisorSum);
+                       }
+                   }
+                 weightsAmount += chunkWeights;
+               });
+  return weightsAmount;
+}
+
+#endif // BOUNDARY_SAMPLER_H
@@ -0,0 +1,74 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * BoundedQueue passes items between the threads of two pipeline stages. Push
+ * blocks while the queue is full, so a fast stage can not run ahead of a slow
+ * one by more than the capacity, and Pop blocks while it is empty until the
+ * queue is closed.
+ *
+ * @tparam T The type of the items.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue (const std::size_t capacity)
+      : capacity_ (capacity == 0 ? 1 : capacity), closed_ (false)
+  {}
+
+  /**
+   * @brief Adds an item, waiting for a free place.
+   */
+  void Push (T item)
+  {
+    std::unique_lock<std::mutex> lock (mutex_);
+    notFull_.wait (lock, [this] ()
+    { return items_.size () < capacity_; });
+    items_.push_back (std::move (item));
+    notEmpty_.notify_one ();
+  }
+
+  /**
+   * @brief Removes the oldest item, waiting for one.
+   *
+   * @return False if the queue is closed and empty, in which case no item
+   * is returned.
+   */
+  bool Pop (T &item)
+  {
+    std::unique_lock<std::mutex> lock (mutex_);
+    notEmpty_.wait (lock, [this] ()
+    { return !items_.empty () || closed_; });
+    if (items_.empty ()) return false;
+
+    item = std::move (items_.front ());
+    items_.pop_front ();
+    notFull_.notify_one ();
+    return true;
+  }
+
+  /**
+   * @brief Tells the consumers that no more items will be pushed.
+   */
+  void Close ()
+  {
+    std::lock_guard<std::mutex> lock (mutex_);
+    closed_ = true;
+    notEmpty_.notify_all ();
+  }
+
+ private:
+  std::size_t capacity_;
+  bool closed_;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable notEmpty_;
+  std::condition_variable notFull_;
+};
+
+#endif // BOUNDED_QUEUE_H
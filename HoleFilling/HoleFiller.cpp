@@ -1,29 +1,463 @@
 #include "HoleFiller.h"
 
-HoleFiller::HoleFiller (const int z, const double epsilon, const int connectivity, const int algorithm_type, const WeightFunctionType &weight_func)
-    : z_ (z), epsilon_ (epsilon), connectivity_ (connectivity), algorithmType (algorithm_type), weightFunc_ (weight_func)
+#include <atomic>
+#include <chrono>
+
+#include "MyWeightFunction.h"
+#include "SpecializedHoleFiller.h"
+
+namespace {
+
+typedef std::chrono::steady_clock StageClock;
+
+/**
+ * @brief Returns the seconds elapsed since a time point.
+ */
+double GetSecondsSince (const StageClock::time_point &start)
+{
+  return std::chrono::duration<double> (StageClock::now () - start).count ();
+}
+
+/**
+ * @brief Runs SpecializedHoleFiller::RegularAlgorithm, see
+ * DispatchDistancePowerSpecialization.
+ */
+struct RegularAlgorithmCall {
+  const std::vector<Pixel> &holePixels;
+  const std::vector<Pixel> &boundaryCoordinates;
+  const std::vector<float> &boundaryValues;
+  double epsilon;
+  int threadCount;
+  int channels;
+  Mat &filledImage;
+
+  template <typename Filler>
+  void Run () const
+  {
+    if (channels == COLOR_CHANNELS)
+      {
+        Filler::template RegularAlgorithm<COLOR_CHANNELS> (
+            holePixels, boundaryCoordinates, boundaryValues, epsilon,
+            threadCount, filledImage);
+      }
+    else
+      {
+        Filler::template RegularAlgorithm<1> (
+            holePixels, boundaryCoordinates, boundaryValues, epsilon,
+            threadCount, filledImage);
+      }
+  }
+};
+
+/**
+ * @brief Runs SpecializedHoleFiller::AccumulateRegularSums, see
+ * DispatchDistancePowerSpecialization.
+ */
+struct RegularSumsCall {
+  const std::vector<Pixel> &holePixels;
+  const std::vector<Pixel> &boundaryCoordinates;
+  const std::vector<float> &boundaryValues;
+  double epsilon;
+  double sign;
+  int threadCount;
+  int channels;
+  Mat &dividendSums;
+  Mat &divisorSums;
+
+  template <typename Filler>
+  void Run () const
+  {
+    if (channels == COLOR_CHANNELS)
+      {
+        Filler::template AccumulateRegularSums<COLOR_CHANNELS> (
+            holePixels, boundaryCoordinates, boundaryValues, epsilon, sign,
+            threadCount, dividendSums, divisorSums);
+      }
+    else
+      {
+        Filler::template AccumulateRegularSums<1> (
+            holePixels, boundaryCoordinates, boundaryValues, epsilon, sign,
+            threadCount, dividendSums, divisorSums);
+      }
+  }
+};
+
+/**
+ * @brief Runs SpecializedHoleFiller::SampledRegularAlgorithm, see
+ * DispatchDistancePowerSpecialization.
+ */
+struct SampledRegularAlgorithmCall {
+  const BoundarySampler &sampler;
+  const std::vector<Pixel> &holePixels;
+  double epsilon;
+  int threadCount;
+  int channels;
+  Mat &filledImage;
+  long long &weightEvaluations;
+
+  template <typename Filler>
+  void Run () const
+  {
+    if (channels == COLOR_CHANNELS)
+      {
+        weightEvaluations =
+            Filler::template SampledRegularAlgorithm<COLOR_CHANNELS> (
+                sampler, holePixels, epsilon, threadCount, filledImage);
+      }
+    else
+      {
+        weightEvaluations = Filler::template SampledRegularAlgorithm<1> (
+            sampler, holePixels, epsilon, threadCount, filledImage);
+      }
+  }
+};
+
+/**
+ * @brief Runs SpecializedHoleFiller::ApproximateAlgorithm, see
+ * DispatchDistancePowerSpecialization.
+ */
+struct ApproximateAlgorithmCall {
+  const HoleLayers &layers;
+  double epsilon;
+  const SweepOptions &options;
+  int channels;
+  Mat &filledImage;
+  SweepResult &result;
+
+  template <typename Filler>
+  void Run () const
+  {
+    if (channels == COLOR_CHANNELS)
+      {
+        result = Filler::template ApproximateAlgorithm<COLOR_CHANNELS> (
+            layers, epsilon, options, filledImage);
+      }
+    else
+      {
+        result = Filler::template ApproximateAlgorithm<1> (
+            layers, epsilon, options, filledImage);
+      }
+  }
+};
+
+}
+
+FillPlan::FillPlan ()
+    : rows_ (0), cols_ (0), z_ (0), epsilon_ (0), connectivity_ (0)
 {}
 
-Mat HoleFiller::FillImage (const Mat &image)
+int FillPlan::Rows () const
 {
+  return rows_;
+}
 
+int FillPlan::Cols () const
+{
+  return cols_;
+}
+
+std::size_t FillPlan::HolesAmount () const
+{
+  return holes_.size ();
+}
+
+HoleFiller::HoleFiller (const int z, const double epsilon, const int connectivity, const int algorithm_type, const WeightFunctionType &weight_func, const int thread_count)
+    : z_ (z), epsilon_ (epsilon), connectivity_ (connectivity), algorithmType (algorithm_type), threadCount_ (thread_count), channels_ (1), approximationTolerance_ (DEFAULT_APPROXIMATION_TOLERANCE), sampleBudget_ (DEFAULT_SAMPLE_BUDGET), residualTolerance_ (DEFAULT_RESIDUAL_TOLERANCE), maxSweeps_ (APPROXIMATE_ALGORITHM_ROUTINE_AMOUNT), coloredSweeps_ (false), sweepsAmount_ (0), residual_ (0), weightFunc_ (weight_func)
+{}
+
+Mat HoleFiller::FillImage (const Mat &image)
+{
   Mat filledImage = image.clone ();
+  FillImageInPlace (filledImage);
+  return filledImage;
+}
+
+void HoleFiller::FillImageInPlace (Mat &image)
+{
+  channels_ = image.channels ();
+  sweepsAmount_ = 0;
+  residual_ = 0;
+  statistics_ = FillStatistics ();
+
+  StageClock::time_point start = StageClock::now ();
   FindHoleAndBoundaryPixels (image);
+  statistics_.findHolesSeconds = GetSecondsSince (start);
+  statistics_.holesAmount = holeRegions_.size ();
+
+  for (HoleRegion &region : holeRegions_)
+    {
+      FillRegion (image, region, SelectAlgorithm (region));
+    }
+
+  ClearFields ();
+}
+
+FillPlan HoleFiller::CreatePlan (const Mat &image)
+{
+  FillPlan plan;
+  plan.rows_ = image.rows;
+  plan.cols_ = image.cols;
+  plan.z_ = z_;
+  plan.epsilon_ = epsilon_;
+  plan.connectivity_ = connectivity_;
+
+  channels_ = image.channels ();
+  statistics_ = FillStatistics ();
+
+  StageClock::time_point start = StageClock::now ();
+  FindHoleAndBoundaryPixels (image);
+  statistics_.findHolesSeconds = GetSecondsSince (start);
+  statistics_.holesAmount = holeRegions_.size ();
+  plan.holes_.resize (holeRegions_.size ());
+
+  for (std::size_t i = 0; i < holeRegions_.size (); ++i)
+    {
+      PlannedHole &hole = plan.holes_[i];
+      hole.algorithm = SelectAlgorithm (holeRegions_[i]);
+      hole.region.bounds = holeRegions_[i].bounds;
+
+      holePixelsVector_.swap (holeRegions_[i].holePixels);
+      boundaryPixelsCoordinatesVector_.swap (
+          holeRegions_[i].boundaryCoordinates);
+      CountHolePixels ();
+
+      start = StageClock::now ();
+      if (hole.algorithm == ALGORITHM_OPTION_TWO)
+        {
+          SetLayers (hole.layers);
+          statistics_.layersAmount += hole.layers.LayersAmount ();
+        }
+      else if (hole.algorithm == ALGORITHM_OPTION_THREE)
+        {
+          PrepareFftAlgorithm (hole.fftKernel);
+        }
+      statistics_.prepareSeconds += GetSecondsSince (start);
+
+      holePixelsVector_.swap (hole.region.holePixels);
+      boundaryPixelsCoordinatesVector_.swap (hole.region.boundaryCoordinates);
+      ClearHoleFields ();
+    }
+
+  ClearFields ();
+  return plan;
+}
+
+Mat HoleFiller::FillImage (const Mat &image, const FillPlan &plan)
+{
+  return FillImage (image, plan, Mat ());
+}
+
+Mat HoleFiller::FillImage (const Mat &image, const FillPlan &plan,
+                           const Mat &initialImage)
+{
+  if (image.rows != plan.rows_ || image.cols != plan.cols_
+      || plan.z_ != z_ || plan.epsilon_ != epsilon_
+      || plan.connectivity_ != connectivity_)
+    {
+      return Mat ();
+    }
+
+  if (!initialImage.empty ()
+      && (initialImage.size () != image.size ()
+          || initialImage.type () != image.type ()))
+    {
+      return Mat ();
+    }
+
+  Mat filledImage = image.clone ();
+  channels_ = image.channels ();
+  sweepsAmount_ = 0;
+  residual_ = 0;
+  statistics_ = FillStatistics ();
+  statistics_.holesAmount = plan.holes_.size ();
+
+  for (const PlannedHole &hole : plan.holes_)
+    {
+      holePixelsVector_ = hole.region.holePixels;
+      boundaryPixelsCoordinatesVector_ = hole.region.boundaryCoordinates;
+      CountHolePixels ();
+
+      for (const Pixel &boundaryPixel : boundaryPixelsCoordinatesVector_)
+        {
+          const float *values = image.ptr<float> (boundaryPixel.first)
+                                + boundaryPixel.second * channels_;
+          boundaryPixelsValuesVector_.insert (
+              boundaryPixelsValuesVector_.end (), values, values + channels_);
+        }
+
+      // The approximate algorithm tells the pixels it did not fill yet by
+      // their hole value, unless they have initial values.
+      bool warmStart = !initialImage.empty ()
+                       && hole.algorithm == ALGORITHM_OPTION_TWO;
+      for (const Pixel &holePixel : holePixelsVector_)
+        {
+          float *values = filledImage.ptr<float> (holePixel.first)
+                          + holePixel.second * channels_;
+          if (warmStart)
+            {
+              const float *initialValues =
+                  initialImage.ptr<float> (holePixel.first)
+                  + holePixel.second * channels_;
+              std::copy (initialValues, initialValues + channels_, values);
+            }
+          else
+            {
+              std::fill (values, values + channels_, (float) HOLE_VALUE);
+            }
+        }
+
+      FillPlannedHole (image, filledImage, hole);
+      ClearHoleFields ();
+    }
 
-  switch (algorithmType)
+  ClearFields ();
+  return filledImage;
+}
+
+void HoleFiller::FillPlannedHole (const Mat &image, Mat &filledImage,
+                                  const PlannedHole &hole)
+{
+  StageClock::time_point start = StageClock::now ();
+  switch (hole.algorithm)
+    {
+      case ALGORITHM_OPTION_TWO:
+        ApproximateAlgorithm (hole.layers, filledImage);
+      statistics_.fillSeconds += GetSecondsSince (start);
+      break;
+
+      case ALGORITHM_OPTION_THREE:
+        FftAlgorithm (hole.fftKernel, filledImage);
+      statistics_.fillSeconds += GetSecondsSince (start);
+      break;
+
+      default:
+        FillHole (image, filledImage, hole.algorithm);
+      break;
+    }
+}
+
+void HoleFiller::FillRegion (Mat &image, HoleRegion &region,
+                             const int algorithm)
+{
+  holePixelsVector_.swap (region.holePixels);
+  boundaryPixelsCoordinatesVector_.swap (region.boundaryCoordinates);
+  boundaryPixelsValuesVector_.swap (region.boundaryValues);
+  CountHolePixels ();
+
+  // The boundary values were copied, so the algorithms only read the
+  // filled values of the image.
+  FillHole (image, image, algorithm);
+
+  holePixelsVector_.swap (region.holePixels);
+  boundaryPixelsCoordinatesVector_.swap (region.boundaryCoordinates);
+  boundaryPixelsValuesVector_.swap (region.boundaryValues);
+  ClearHoleFields ();
+}
+
+void HoleFiller::FillHole (const Mat &image, Mat &filledImage,
+                           const int algorithm)
+{
+  StageClock::time_point start = StageClock::now ();
+  switch (algorithm)
     {
       case ALGORITHM_OPTION_ONE:
         RegularAlgorithm (image, filledImage);
       break;
 
       case ALGORITHM_OPTION_TWO:
-        SetLayers (image);
-      ApproximateAlgorithm (image, filledImage);
+        SetLayers (layers_);
+      statistics_.prepareSeconds += GetSecondsSince (start);
+      start = StageClock::now ();
+      ApproximateAlgorithm (layers_, filledImage);
+      break;
+
+      case ALGORITHM_OPTION_THREE:
+        PrepareFftAlgorithm (fftKernel_);
+      statistics_.prepareSeconds += GetSecondsSince (start);
+      start = StageClock::now ();
+      FftAlgorithm (fftKernel_, filledImage);
+      break;
+
+      case ALGORITHM_OPTION_FOUR:
+        HierarchicalAlgorithm (image, filledImage);
+      break;
+
+      case ALGORITHM_OPTION_FIVE:
+        MultigridAlgorithm (filledImage);
       break;
     }
+  statistics_.fillSeconds += GetSecondsSince (start);
+}
 
-  ClearFields ();
-  return filledImage;
+int HoleFiller::SelectAlgorithm (const HoleRegion &region) const
+{
+  if (algorithmType != ALGORITHM_OPTION_AUTO) return algorithmType;
+
+  if (algorithmSelector_) return algorithmSelector_ (region);
+
+  // The FFT and hierarchical algorithms weigh offsets, not pixel pairs, so
+  // other weights may depend on more than the offset.
+  if (!IsDistancePowerWeight ()) return ALGORITHM_OPTION_ONE;
+
+  long long pairsAmount =
+      (long long) region.holePixels.size () * region.boundaryCoordinates.size ();
+  if (pairsAmount <= AUTO_REGULAR_MAX_PAIRS) return ALGORITHM_OPTION_ONE;
+
+  long long boundsArea =
+      (long long) (region.bounds.maxX - region.bounds.minX + 1)
+      * (region.bounds.maxY - region.bounds.minY + 1);
+  if (boundsArea <= AUTO_FFT_MAX_AREA) return ALGORITHM_OPTION_THREE;
+
+  return ALGORITHM_OPTION_FOUR;
+}
+
+void HoleFiller::SetAlgorithmSelector (
+    const AlgorithmSelectorType &algorithm_selector)
+{
+  algorithmSelector_ = algorithm_selector;
+}
+
+void HoleFiller::SetApproximationTolerance (const double tolerance)
+{
+  approximationTolerance_ = tolerance;
+}
+
+void HoleFiller::SetSampleBudget (const int sample_budget)
+{
+  sampleBudget_ = sample_budget;
+}
+
+void HoleFiller::SetConvergenceCriteria (const double residual_tolerance,
+                                         const int max_sweeps)
+{
+  residualTolerance_ = residual_tolerance;
+  maxSweeps_ = max_sweeps;
+}
+
+void HoleFiller::SetColoredSweeps (const bool colored)
+{
+  coloredSweeps_ = colored;
+}
+
+int HoleFiller::GetSweepsAmount () const
+{
+  return sweepsAmount_;
+}
+
+double HoleFiller::GetResidual () const
+{
+  return residual_;
+}
+
+const FillStatistics &HoleFiller::GetStatistics () const
+{
+  return statistics_;
+}
+
+void HoleFiller::CountHolePixels ()
+{
+  statistics_.holePixelsAmount += holePixelsVector_.size ();
+  statistics_.boundaryPixelsAmount += boundaryPixelsCoordinatesVector_.size ();
 }
 
 Pixel HoleFiller::GetNeighborPixel (const Pixel currentPixel, const int index)
@@ -63,231 +497,711 @@ Pixel HoleFiller::GetNeighborPixel (const Pixel currentPixel, const int index)
 
 void HoleFiller::FindHoleAndBoundaryPixels (const Mat &image)
 {
-  Pixel firstHolePixel = FindFirstHolePixel (image);
-  FloodFill (image, firstHolePixel);
-}
+  SetMaskBitmap (image);
+  holeBitmap_.Reset (image.rows, image.cols);
 
-Pixel HoleFiller::FindFirstHolePixel (const Mat &image)
-{
-  for (int x = 0; x < image.cols; x++)
+  // The fill of a hole clears its pixels from the mask, so the first
+  // pixel left in the mask belongs to the next hole.
+  for (int x = 0; x < image.rows; x++)
     {
-      for (int y = 0; y < image.rows; y++)
+      const uint64_t *maskWords = maskBitmap_.RowWords (x);
+      for (int word = 0; word < maskBitmap_.WordsPerRow (); word++)
         {
-          if (image.at<float> (x, y) == HOLE_VALUE)
+          while (maskWords[word] != 0)
             {
-              return Pixel (x, y);
+              int y = word * 64 + PixelBitmap::LowestBit (maskWords[word]);
+              holeRegions_.push_back (HoleRegion ());
+              FindHoleRegion (image, Pixel (x, y), holeRegions_.back ());
             }
         }
     }
+}
 
-  Pixel notFoundPixel (HOLE_VALUE, HOLE_VALUE);
-  return notFoundPixel;
+void HoleFiller::FindHoleRegion (const Mat &image, const Pixel &firstPixel,
+                                 HoleRegion &region)
+{
+  PixelBounds holeBounds = FloodFill (firstPixel);
+  CollectHoleAndBoundaryPixels (image, holeBounds, region);
 }
 
-void HoleFiller::FloodFill (const Mat &image, Pixel currentPixel)
+void HoleFiller::SetMaskBitmap (const Mat &image)
 {
-  int x = currentPixel.first;
-  int y = currentPixel.second;
+  maskBitmap_.Reset (image.rows, image.cols);
 
-  int curPixelIndexVal = INDEX(y, x, image.cols);
+  for (int x = 0; x < image.rows; x++)
+    {
+      const float *values = image.ptr<float> (x);
+      uint64_t *maskWords = maskBitmap_.RowWords (x);
+      for (int word = 0; word < maskBitmap_.WordsPerRow (); word++)
+        {
+          int wordCols = std::min (64, image.cols - word * 64);
+          const float *wordValues = values + word * 64 * channels_;
+          uint64_t bits = 0;
+          for (int b = 0; b < wordCols; b++)
+            {
+              bits |= uint64_t (wordValues[b * channels_] == HOLE_VALUE) << b;
+            }
+          maskWords[word] = bits;
+        }
+    }
+}
 
-  if (visitedSet.count (curPixelIndexVal) > 0) return;
+PixelBounds HoleFiller::FloodFill (const Pixel firstPixel)
+{
+  PixelBounds bounds {firstPixel.first, firstPixel.second, firstPixel.first,
+                      firstPixel.second};
 
-  visitedSet.insert (curPixelIndexVal);
+  // Diagonal neighbors connect spans that only touch at their corners.
+  int diagonalReach = (connectivity_ == CONNECTIVITY_OPTION_2) ? 1 : 0;
 
-  if (x < 0 || x >= image.cols || y < 0 || y >= image.rows) return;
+  int rows = maskBitmap_.Rows ();
+  int cols = maskBitmap_.Cols ();
+  auto isUnvisitedHole = [&] (int x, int y)
+  {
+    return maskBitmap_.Get (x, y);
+  };
 
-  float currentPixelValue = image.at<float> (x, y);
-  if (currentPixelValue != HOLE_VALUE)
+  std::vector<Pixel> seeds (1, firstPixel);
+  while (!seeds.empty ())
     {
-      float currentValue = image.at<float> (x, y);
-      boundaryPixelsValuesVector_.push_back (currentValue);
-      boundaryPixelsCoordinatesVector_.push_back (currentPixel);
-      return;
+      int x = seeds.back ().first;
+      int y = seeds.back ().second;
+      seeds.pop_back ();
+
+      if (!isUnvisitedHole (x, y)) continue;
+
+      // Grow the seed to the whole span of hole pixels in its row.
+      int spanBegin = y;
+      int spanEnd = y;
+      while (spanBegin > 0 && isUnvisitedHole (x, spanBegin - 1))
+        {
+          spanBegin--;
+        }
+      while (spanEnd < cols - 1 && isUnvisitedHole (x, spanEnd + 1))
+        {
+          spanEnd++;
+        }
+
+      for (int i = spanBegin; i <= spanEnd; ++i)
+        {
+          maskBitmap_.Unset (x, i);
+          holeBitmap_.Set (x, i);
+        }
+
+      bounds.minX = std::min (bounds.minX, x);
+      bounds.maxX = std::max (bounds.maxX, x);
+      bounds.minY = std::min (bounds.minY, spanBegin);
+      bounds.maxY = std::max (bounds.maxY, spanEnd);
+
+      // Seed every run of hole pixels touching the span in the rows above
+      // and below.
+      int scanBegin = std::max (spanBegin - diagonalReach, 0);
+      int scanEnd = std::min (spanEnd + diagonalReach, cols - 1);
+      for (int neighborX = x - 1; neighborX <= x + 1; neighborX += 2)
+        {
+          if (neighborX < 0 || neighborX >= rows) continue;
+
+          bool inRun = false;
+          for (int i = scanBegin; i <= scanEnd; ++i)
+            {
+              bool isHole = isUnvisitedHole (neighborX, i);
+              if (isHole && !inRun)
+                {
+                  seeds.push_back (Pixel (neighborX, i));
+                }
+              inRun = isHole;
+            }
+        }
     }
 
-  holePixelsVector_.push_back (currentPixel);
+  return bounds;
+}
+
+void HoleFiller::CollectHoleAndBoundaryPixels (const Mat &image,
+                                               const PixelBounds &holeBounds,
+                                               HoleRegion &region)
+{
+  bool diagonal = (connectivity_ == CONNECTIVITY_OPTION_2);
 
-  for (int i = 0; i < 8; ++i)
+  int minX = std::max (holeBounds.minX - 1, 0);
+  int maxX = std::min (holeBounds.maxX + 1, image.rows - 1);
+  int minY = std::max (holeBounds.minY - 1, 0);
+  int maxY = std::min (holeBounds.maxY + 1, image.cols - 1);
+
+  // Only this hole is in holeBitmap_, so its boundary lies in the bounds.
+  int firstWord = minY / 64;
+  int lastWord = maxY / 64;
+  for (int x = minX; x <= maxX; ++x)
     {
-      if ((i < 4) || (i >= 4 && connectivity_ == CONNECTIVITY_OPTION_2))
+      const uint64_t *holeWords = holeBitmap_.RowWords (x);
+      for (int word = firstWord; word <= lastWord; ++word)
         {
-          FloodFill (image, GetNeighborPixel (currentPixel, i));
+          for (uint64_t bits = holeWords[word]; bits != 0; bits &= bits - 1)
+            {
+              int y = word * 64 + PixelBitmap::LowestBit (bits);
+              region.holePixels.push_back (Pixel (x, y));
+            }
+
+          for (uint64_t bits = holeBitmap_.GetBoundaryWord (x, word, diagonal);
+               bits != 0; bits &= bits - 1)
+            {
+              int y = word * 64 + PixelBitmap::LowestBit (bits);
+              const float *values = image.ptr<float> (x) + y * channels_;
+              region.boundaryCoordinates.push_back (Pixel (x, y));
+              region.boundaryValues.insert (region.boundaryValues.end (),
+                                            values, values + channels_);
+            }
         }
     }
+
+  region.bounds = PixelBounds {minX, minY, maxX, maxY};
+
+  for (int x = holeBounds.minX; x <= holeBounds.maxX; ++x)
+    {
+      uint64_t *holeWords = holeBitmap_.RowWords (x);
+      std::fill (holeWords + holeBounds.minY / 64,
+                 holeWords + holeBounds.maxY / 64 + 1, uint64_t (0));
+    }
 }
 
 void HoleFiller::RegularAlgorithm (const Mat &image, Mat &filledImage)
 {
-  for (Pixel holePixel : holePixelsVector_)
+  if (sampleBudget_ > 0
+      && boundaryPixelsCoordinatesVector_.size () > (std::size_t) sampleBudget_)
     {
-      double dividendSum = 0;
-      double divisorSum = 0;
+      SampledRegularAlgorithm (filledImage);
+      return;
+    }
+
+  statistics_.weightEvaluations +=
+      (long long) holePixelsVector_.size ()
+      * boundaryPixelsCoordinatesVector_.size ();
+
+  if (RunRegularKernel (
+      RegularAlgorithmCall {holePixelsVector_,
+                            boundaryPixelsCoordinatesVector_,
+                            boundaryPixelsValuesVector_, epsilon_,
+                            threadCount_, channels_, filledImage}))
+    return;
+
+  ParallelFor (holePixelsVector_.size (), threadCount_,
+               [&] (std::size_t begin, std::size_t end)
+               {
+                 for (std::size_t i = begin; i < end; ++i)
+                   {
+                     RegularAlgorithmPixel (holePixelsVector_[i], filledImage);
+                   }
+               });
+}
+
+void HoleFiller::RegularAlgorithmPixel (const Pixel &holePixel,
+                                        Mat &filledImage)
+{
+  double dividendSums[COLOR_CHANNELS] = {0, 0, 0};
+  double divisorSum = 0;
+  AccumulateRegularPixel (holePixel, dividendSums, divisorSum);
 
+  int x = holePixel.first;
+  int y = holePixel.second;
+  float *filledPixel = filledImage.ptr<float> (x) + y * channels_;
+  for (int c = 0; c < channels_; ++c)
+    {
+      filledPixel[c] = (dividendSums[c] / divisorSum);
+    }
+}
+
+void HoleFiller::AccumulateRegularPixel (const Pixel &holePixel,
+                                         double *dividendSums,
+                                         double &divisorSum) const
+{
+  if (boundarySoA_.size > 0)
+    {
+      SimdWeightKernel::Accumulate (boundarySoA_, holePixel, z_, epsilon_,
+                                    dividendSums[0], divisorSum);
+    }
+
+  // Also taken when all the float weights of the kernel underflowed.
+  if (divisorSum == 0)
+    {
+      dividendSums[0] = 0;
       for (int i = 0; i < boundaryPixelsCoordinatesVector_.size (); ++i)
         {
           Pixel boundaryPixel = boundaryPixelsCoordinatesVector_[i];
-          float boundaryPixelValue = boundaryPixelsValuesVector_[i];
+          const float *boundaryPixelValues =
+              &boundaryPixelsValuesVector_[i * channels_];
 
-          double currWeightValue =
-              weightFunc_ (holePixel, boundaryPixel, z_, epsilon_);
+          double currWeightValue = GetWeight (holePixel, boundaryPixel);
 
-          dividendSum += (boundaryPixelValue * currWeightValue);
+          for (int c = 0; c < channels_; ++c)
+            {
+              dividendSums[c] += (boundaryPixelValues[c] * currWeightValue);
+            }
           divisorSum += currWeightValue;
         }
+    }
+}
+
+template <typename Call>
+bool HoleFiller::RunRegularKernel (const Call &specializedCall)
+{
+  if (!IsDistancePowerWeight ()) return false;
 
-      int x = holePixel.first;
-      int y = holePixel.second;
-      filledImage.at<float> (x, y) = (dividendSum / divisorSum);
+  // The vectorized kernel sums a single channel.
+  if (channels_ == 1 && SimdWeightKernel::IsVectorized ()
+      && SimdWeightKernel::SupportsPower (z_))
+    {
+      boundarySoA_.Assign (boundaryPixelsCoordinatesVector_,
+                           boundaryPixelsValuesVector_);
+      return false;
     }
+
+  if (DispatchDistancePowerSpecialization (z_, connectivity_,
+                                           specializedCall))
+    return true;
+
+  PixelBounds bounds = GetHoleBounds ();
+  AcquireWeightTable (bounds.maxX - bounds.minX, bounds.maxY - bounds.minY);
+  return false;
 }
 
-void HoleFiller::SetLayers (const Mat &image)
+void HoleFiller::AccumulateRegularSums (
+    const std::vector<Pixel> &holePixels,
+    const std::vector<Pixel> &boundaryCoordinates,
+    const std::vector<float> &boundaryValues, const double sign,
+    Mat &dividendSums, Mat &divisorSums)
 {
+  if (holePixels.empty () || boundaryCoordinates.empty ()) return;
+
+  holePixelsVector_ = holePixels;
+  boundaryPixelsCoordinatesVector_ = boundaryCoordinates;
+  boundaryPixelsValuesVector_ = boundaryValues;
+  statistics_.weightEvaluations +=
+      (long long) holePixels.size () * boundaryCoordinates.size ();
 
-  int curLayer = 0;
-  curLayerVector = boundaryPixelsCoordinatesVector_;
-  while (!(curLayerVector.empty ()))
+  if (!RunRegularKernel (
+      RegularSumsCall {holePixels, boundaryCoordinates, boundaryValues,
+                       epsilon_, sign, threadCount_, channels_, dividendSums,
+                       divisorSums}))
     {
+      ParallelFor (holePixels.size (), threadCount_,
+                   [&] (std::size_t begin, std::size_t end)
+                   {
+                     for (std::size_t i = begin; i < end; ++i)
+                       {
+                         const Pixel &holePixel = holePixels[i];
+                         double pixelDividendSums[COLOR_CHANNELS] = {0, 0, 0};
+                         double pixelDivisorSum = 0;
+                         AccumulateRegularPixel (holePixel, pixelDividendSums,
+                                                 pixelDivisorSum);
 
-      for (Pixel holePixel : curLayerVector)
-        {
-          //Entering the boarder pixels to the map
-          if (curLayer == 1)
-            {
-              int x = holePixel.first;
-              int y = holePixel.second;
-              int curPixelIndexVal = INDEX(y, x, image.cols);
-              layerMap[curPixelIndexVal] = curLayer;
-            }
+                         double *sums = dividendSums.ptr<double> (
+                                            holePixel.first)
+                                        + holePixel.second * channels_;
+                         for (int c = 0; c < channels_; ++c)
+                           {
+                             sums[c] += sign * pixelDividendSums[c];
+                           }
+                         divisorSums.ptr<double> (holePixel.first)
+                             [holePixel.second] += sign * pixelDivisorSum;
+                       }
+                   });
+    }
 
-          SetLayerHelper (image, holePixel, curLayer);
-        }
+  ClearHoleFields ();
+}
+
+void HoleFiller::SampledRegularAlgorithm (Mat &filledImage)
+{
+  BoundarySampler sampler (boundaryPixelsCoordinatesVector_,
+                           boundaryPixelsValuesVector_, channels_,
+                           sampleBudget_);
+
+  long long weightEvaluations = 0;
+  if (IsDistancePowerWeight ()
+      && DispatchDistancePowerSpecialization (
+          z_, connectivity_,
+          SampledRegularAlgorithmCall {sampler, holePixelsVector_, epsilon_,
+                                       threadCount_, channels_, filledImage,
+                                       weightEvaluations}))
+    {
+      statistics_.weightEvaluations += weightEvaluations;
+      return;
+    }
 
-      curLayerVector = tempLayerVector;
-      tempLayerVector.clear ();
-      curLayer += 1;
+  PixelBounds bounds = GetHoleBounds ();
+  AcquireWeightTable (bounds.maxX - bounds.minX, bounds.maxY - bounds.minY);
+  auto weight = [this] (const Pixel &p1, const Pixel &p2)
+  {
+    return GetWeight (p1, p2);
+  };
+
+  if (channels_ == COLOR_CHANNELS)
+    {
+      statistics_.weightEvaluations +=
+          sampler.FillHolePixels<COLOR_CHANNELS> (holePixelsVector_, weight,
+                                                  threadCount_, filledImage);
+    }
+  else
+    {
+      statistics_.weightEvaluations += sampler.FillHolePixels<1> (
+          holePixelsVector_, weight, threadCount_, filledImage);
     }
 }
 
-void HoleFiller::SetLayerHelper (const Mat &image, const Pixel currentPixel,
-                            const int currentLayer)
+void HoleFiller::PrepareFftAlgorithm (FftKernel &fftKernel)
 {
-  for (int i = 0; i < 8; ++i)
+  if (holePixelsVector_.empty ()) return;
+
+  PixelBounds bounds = GetHoleBounds ();
+  int minX = bounds.minX;
+  int minY = bounds.minY;
+  int boxX = bounds.maxX - minX + 1;
+  int boxY = bounds.maxY - minY + 1;
+
+  // Offsets between two pixels of the box lie in (-box, box), so a period of
+  // at least 2 * box - 1 keeps the circular convolution free of aliasing.
+  int dftX = getOptimalDFTSize (2 * boxX - 1);
+  int dftY = getOptimalDFTSize (2 * boxY - 1);
+
+  Mat boundaryIndicator = Mat::zeros (dftX, dftY, CV_64F);
+  for (const Pixel &boundaryPixel : boundaryPixelsCoordinatesVector_)
+    {
+      boundaryIndicator.at<double> (boundaryPixel.first - minX,
+                                    boundaryPixel.second - minY) = 1;
+    }
+
+  // kernel(d) holds the weight between a hole pixel p and the boundary pixel
+  // p - d, stored with wrap around. The zero offset never pairs a hole pixel
+  // with a boundary pixel, so it is left out to keep 1 / epsilon from
+  // amplifying the round off of the transforms.
+  Mat kernel = Mat::zeros (dftX, dftY, CV_64F);
+  Pixel origin (0, 0);
+  for (int dx = 1 - boxX; dx < boxX; ++dx)
     {
-      if ((i < 4) || (i >= 4 && connectivity_ == CONNECTIVITY_OPTION_2))
+      for (int dy = 1 - boxY; dy < boxY; ++dy)
         {
-          SetLayer (image, GetNeighborPixel (currentPixel, i), currentLayer);
+          if (dx == 0 && dy == 0) continue;
+
+          // Every offset is weighed once, so a weight table would not pay
+          // for itself.
+          kernel.at<double> ((dx + dftX) % dftX, (dy + dftY) % dftY) =
+              weightFunc_ (origin, Pixel (-dx, -dy), z_, epsilon_);
         }
     }
+  statistics_.weightEvaluations += (long long) (2 * boxX - 1) * (2 * boxY - 1)
+                                   - 1;
+
+  fftKernel.minX = minX;
+  fftKernel.minY = minY;
+  fftKernel.dftX = dftX;
+  fftKernel.dftY = dftY;
+
+  // The kernel spectrum, the weights, is shared by all the channels.
+  Mat indicatorSpectrum;
+  dft (kernel, fftKernel.kernelSpectrum, DFT_COMPLEX_OUTPUT);
+  dft (boundaryIndicator, indicatorSpectrum, DFT_COMPLEX_OUTPUT);
+  mulSpectrums (indicatorSpectrum, fftKernel.kernelSpectrum,
+                indicatorSpectrum, 0);
+
+  dft (indicatorSpectrum, fftKernel.divisorSums,
+       DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT);
 }
-void HoleFiller::SetLayer (const Mat &image, const Pixel currentPixel,
-                           const int currentLayer)
+
+void HoleFiller::FftAlgorithm (const FftKernel &fftKernel, Mat &filledImage)
 {
-  int x = currentPixel.first;
-  int y = currentPixel.second;
-  int curPixelIndexVal = INDEX(y, x, image.cols);
-  float currentPixelValue = image.at<float> (x, y);
+  if (holePixelsVector_.empty ()) return;
+
+  int minX = fftKernel.minX;
+  int minY = fftKernel.minY;
 
-  if (currentPixelValue == HOLE_VALUE)
+  for (int c = 0; c < channels_; ++c)
     {
-      if (!(layerMap.count (curPixelIndexVal)))
+      Mat boundaryValues = Mat::zeros (fftKernel.dftX, fftKernel.dftY, CV_64F);
+      for (int i = 0; i < boundaryPixelsCoordinatesVector_.size (); ++i)
         {
-          tempLayerVector.push_back (currentPixel);
-          layerMap[curPixelIndexVal] = (currentLayer + 1);
-          layerMapReverse[currentLayer + 1].push_back (currentPixel);
+          boundaryValues.at<double> (
+              boundaryPixelsCoordinatesVector_[i].first - minX,
+              boundaryPixelsCoordinatesVector_[i].second - minY) =
+              boundaryPixelsValuesVector_[i * channels_ + c];
+        }
+
+      Mat valuesSpectrum;
+      dft (boundaryValues, valuesSpectrum, DFT_COMPLEX_OUTPUT);
+      mulSpectrums (valuesSpectrum, fftKernel.kernelSpectrum, valuesSpectrum,
+                    0);
+
+      Mat dividendSums;
+      dft (valuesSpectrum, dividendSums,
+           DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT);
+
+      for (Pixel holePixel : holePixelsVector_)
+        {
+          int x = holePixel.first;
+          int y = holePixel.second;
+          double dividendSum = dividendSums.at<double> (x - minX, y - minY);
+          double divisorSum =
+              fftKernel.divisorSums.at<double> (x - minX, y - minY);
+          filledImage.ptr<float> (x)[y * channels_ + c] =
+              (dividendSum / divisorSum);
         }
     }
 }
 
-void HoleFiller::ApproximateAlgorithm (const Mat &image, Mat &filledImage)
+void HoleFiller::HierarchicalAlgorithm (const Mat &image, Mat &filledImage)
+{
+  BoundaryQuadTree quadTree (boundaryPixelsCoordinatesVector_,
+                             boundaryPixelsValuesVector_, channels_);
+
+  // Using a cluster at its centroid cancels the first order term of the
+  // weight change across it, leaving a relative error of about
+  // (z * size / distance)^2 / 2.
+  double theta =
+      std::sqrt (2 * approximationTolerance_) / std::max (std::abs (z_), 1);
+
+  std::atomic<long long> weightEvaluations (0);
+  ParallelFor (holePixelsVector_.size (), threadCount_,
+               [&] (std::size_t begin, std::size_t end)
+               {
+                 long long chunkWeights = 0;
+                 for (std::size_t i = begin; i < end; ++i)
+                   {
+                     const Pixel &holePixel = holePixelsVector_[i];
+                     double dividendSums[COLOR_CHANNELS] = {0, 0, 0};
+                     double divisorSum = 0;
+                     chunkWeights += quadTree.Accumulate (
+                         holePixel, weightFunc_, z_, epsilon_, theta,
+                         dividendSums, divisorSum);
+
+                     float *filledPixel =
+                         filledImage.ptr<float> (holePixel.first)
+                         + holePixel.second * channels_;
+                     for (int c = 0; c < channels_; ++c)
+                       {
+                         filledPixel[c] = (dividendSums[c] / divisorSum);
+                       }
+                   }
+                 weightEvaluations += chunkWeights;
+               });
+  statistics_.weightEvaluations += weightEvaluations;
+}
+
+void HoleFiller::MultigridAlgorithm (Mat &filledImage)
 {
+  const Pixel origin (0, 0);
+  MultigridSolver solver (connectivity_, GetWeight (origin, Pixel (1, 0)),
+                          GetWeight (origin, Pixel (1, 1)));
+  statistics_.weightEvaluations += 2;
+
+  PixelBounds bounds = GetHoleBounds ();
+  std::vector<float> channelValues (boundaryPixelsCoordinatesVector_.size ());
+  std::vector<float> holeValues;
 
-  for (int j = 0; j < APPROXIMATE_ALGORITHM_ROUTINE_AMOUNT; ++j)
+  for (int c = 0; c < channels_; ++c)
     {
-      for (auto it = layerMapReverse.begin ();
-           it != layerMapReverse.end (); ++it)
+      for (std::size_t i = 0; i < channelValues.size (); ++i)
         {
-          for (Pixel holePixel : it->second)
-            {
-              double dividendSum = 0;
-              double divisorSum = 0;
+          channelValues[i] = boundaryPixelsValuesVector_[i * channels_ + c];
+        }
 
-              int x = holePixel.first;
-              int y = holePixel.second;
-              int curPixelIndexVal = INDEX(y, x, image.cols);
+      solver.Solve (holePixelsVector_, boundaryPixelsCoordinatesVector_,
+                    channelValues, bounds.minX, bounds.minY,
+                    bounds.maxX - bounds.minX + 1,
+                    bounds.maxY - bounds.minY + 1, holeValues);
 
-              int myLayerNumber = layerMap[curPixelIndexVal];
+      for (std::size_t i = 0; i < holePixelsVector_.size (); ++i)
+        {
+          filledImage.ptr<float> (holePixelsVector_[i].first)
+              [holePixelsVector_[i].second * channels_ + c] = holeValues[i];
+        }
+    }
+}
 
-              for (int i = 0; i < 8; ++i)
-                {
-                  if ((i < 4)
-                      || (i >= 4 && connectivity_ == CONNECTIVITY_OPTION_2))
-                    {
-                      CalculatePixelAffect (filledImage, holePixel,
-                                            myLayerNumber,
-                                            GetNeighborPixel (holePixel, i),
-                                            dividendSum, divisorSum);
-                    }
-                }
+void HoleFiller::SetLayers (HoleLayers &layers)
+{
+  PixelBounds bounds = GetHoleBounds ();
+  if (connectivity_ == CONNECTIVITY_OPTION_2)
+    {
+      Neighborhood<CONNECTIVITY_OPTION_2>::SetLayers (
+          holePixelsVector_, boundaryPixelsCoordinatesVector_, bounds, layers);
+    }
+  else
+    {
+      Neighborhood<CONNECTIVITY_OPTION_1>::SetLayers (
+          holePixelsVector_, boundaryPixelsCoordinatesVector_, bounds, layers);
+    }
+}
 
-              filledImage.at<float> (x, y) = (dividendSum / divisorSum);
-            }
-        }
+void HoleFiller::ApproximateAlgorithm (const HoleLayers &layers,
+                                       Mat &filledImage)
+{
+  SweepOptions options {maxSweeps_, residualTolerance_, coloredSweeps_,
+                        threadCount_};
+  SweepResult result {0, 0};
+
+  if (!(IsDistancePowerWeight ()
+        && DispatchDistancePowerSpecialization (
+            z_, connectivity_,
+            ApproximateAlgorithmCall {layers, epsilon_, options, channels_,
+                                      filledImage, result})))
+    {
+      // Neighbors are at most one pixel away on each axis.
+      AcquireWeightTable (1, 1);
+
+      auto update = [&] (const Pixel &holePixel, int layer)
+      {
+        double dividendSums[COLOR_CHANNELS] = {0, 0, 0};
+        double divisorSum = 0;
+
+        for (int i = 0; i < 8; ++i)
+          {
+            if ((i < 4)
+                || (i >= 4 && connectivity_ == CONNECTIVITY_OPTION_2))
+              {
+                CalculatePixelAffect (layers, filledImage, holePixel, layer,
+                                      GetNeighborPixel (holePixel, i),
+                                      dividendSums, divisorSum);
+              }
+          }
+
+        float *values = filledImage.ptr<float> (holePixel.first)
+                        + holePixel.second * channels_;
+        double change = 0;
+        for (int c = 0; c < channels_; ++c)
+          {
+            float newValue = (float) (dividendSums[c] / divisorSum);
+            change = std::max (change, (double) std::fabs (newValue
+                                                           - values[c]));
+            values[c] = newValue;
+          }
+        return change;
+      };
+      result = RunSweeps (layers, connectivity_, options, update);
     }
+
+  sweepsAmount_ = std::max (sweepsAmount_, result.sweepsAmount);
+  residual_ = std::max (residual_, result.residual);
+  statistics_.sweepsAmount += result.sweepsAmount;
+  statistics_.layersAmount += layers.LayersAmount ();
+  statistics_.weightEvaluations += (long long) result.sweepsAmount
+                                   * layers.Pixels ().size () * connectivity_;
 }
 
-void HoleFiller::CalculatePixelAffect (const Mat &image, const Pixel &holePixel,
-                                  int maximumLayerNumber, const Pixel
-                                  &boundaryPixel, double &dividendSum,
-                                  double &divisorSum)
+void HoleFiller::CalculatePixelAffect (const HoleLayers &layers,
+                                       const Mat &image, const Pixel &holePixel,
+                                       int maximumLayerNumber, const Pixel
+                                       &boundaryPixel, double *dividendSums,
+                                       double &divisorSum)
 {
 
   int x = boundaryPixel.first;
   int y = boundaryPixel.second;
 
-  if (IsPixelAffecting (image, boundaryPixel, maximumLayerNumber))
+  if (IsPixelAffecting (layers, image, boundaryPixel, maximumLayerNumber))
     {
 
-      float boundaryPixelValue = image.at<float> (x, y);
+      const float *boundaryPixelValues = image.ptr<float> (x) + y * channels_;
 
-      double currWeightValue =
-          weightFunc_ (holePixel, boundaryPixel, z_, epsilon_);
-      dividendSum += (boundaryPixelValue * currWeightValue);
+      double currWeightValue = GetWeight (holePixel, boundaryPixel);
+      for (int c = 0; c < channels_; ++c)
+        {
+          dividendSums[c] += (boundaryPixelValues[c] * currWeightValue);
+        }
       divisorSum += currWeightValue;
 
     }
 }
 
 bool
-HoleFiller::IsPixelAffecting (const Mat &image, Pixel pixel,
-                              int maximumLayerNumber)
+HoleFiller::IsPixelAffecting (const HoleLayers &layers, const Mat &image,
+                              Pixel pixel, int maximumLayerNumber)
 {
   int x = pixel.first;
   int y = pixel.second;
 
-  if (image.at<float> (x, y) != HOLE_VALUE)
-    {
+  // Neighbors outside the layers grid are outside the image.
+  if (!layers.Contains (x, y)) return false;
 
-      int curPixelIndexVal = INDEX(y, x, image.cols);
-      int currentPixelLayer = layerMap[curPixelIndexVal];
-      if (currentPixelLayer <= maximumLayerNumber)
-        {
-          return true;
-        }
+  if (layers.Get (x, y) <= maximumLayerNumber && !IsHoleValue (image, x, y))
+    {
+      return true;
     }
 
   return false;
 }
 
-void HoleFiller::ClearFields ()
+bool HoleFiller::IsHoleValue (const Mat &image, const int x,
+                              const int y) const
+{
+  return image.ptr<float> (x)[y * channels_] == HOLE_VALUE;
+}
+
+bool HoleFiller::IsDistancePowerWeight () const
+{
+  typedef double (*WeightFunctionPointerType) (Pixel, Pixel, int, double);
+
+  const WeightFunctionPointerType *weightFunctionPointer =
+      weightFunc_.target<WeightFunctionPointerType> ();
+  return weightFunctionPointer != nullptr
+         && *weightFunctionPointer == &MyWeightFunction::GetWeight;
+}
+
+PixelBounds HoleFiller::GetHoleBounds () const
+{
+  PixelBounds bounds {holePixelsVector_[0].first, holePixelsVector_[0].second,
+                      holePixelsVector_[0].first, holePixelsVector_[0].second};
+
+  // The boundary surrounds the hole, so its bounds are those of both.
+  for (const Pixel &boundaryPixel : boundaryPixelsCoordinatesVector_)
+    {
+      bounds.minX = std::min (bounds.minX, boundaryPixel.first);
+      bounds.maxX = std::max (bounds.maxX, boundaryPixel.first);
+      bounds.minY = std::min (bounds.minY, boundaryPixel.second);
+      bounds.maxY = std::max (bounds.maxY, boundaryPixel.second);
+    }
+
+  return bounds;
+}
+
+void HoleFiller::AcquireWeightTable (const int extentX, const int extentY)
+{
+  if (IsDistancePowerWeight ())
+    {
+      weightTable_ = WeightTable::Get (z_, epsilon_, extentX, extentY);
+    }
+}
+
+double HoleFiller::GetWeight (const Pixel &p1, const Pixel &p2) const
+{
+  int dx = p2.first - p1.first;
+  int dy = p2.second - p1.second;
+
+  if (weightTable_ && std::abs (dx) <= weightTable_->ExtentX ()
+      && std::abs (dy) <= weightTable_->ExtentY ())
+    {
+      return weightTable_->GetWeight (dx, dy);
+    }
+
+  return weightFunc_ (p1, p2, z_, epsilon_);
+}
+
+void HoleFiller::ClearHoleFields ()
 {
-  visitedSet.clear ();
   holePixelsVector_.clear ();
   boundaryPixelsCoordinatesVector_.clear ();
   boundaryPixelsValuesVector_.clear ();
-  layerMap.clear ();
-  layerMapReverse.clear ();
-  curLayerVector.clear ();
-  tempLayerVector.clear ();
+  boundarySoA_.Clear ();
+  fftKernel_.kernelSpectrum.release ();
+  fftKernel_.divisorSums.release ();
+}
+
+void HoleFiller::ClearFields ()
+{
+  ClearHoleFields ();
+  // The table is kept between the holes of a fill, and left to the
+  // WeightTable cache after it.
+  weightTable_.reset ();
+  maskBitmap_.Clear ();
+  holeBitmap_.Clear ();
+  holeRegions_.clear ();
+  layers_.Clear ();
 }
\ No newline at end of file
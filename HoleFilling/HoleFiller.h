@@ -1,3 +1,6 @@
+#ifndef HOLE_FILLER_H
+#define HOLE_FILLER_H
+
 #include <opencv2/core.hpp>
 #include <vector>
 #include <unordered_map>
@@ -7,13 +10,46 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
 
+#include "WeightFunction.h"
+#include "ApproximateSweeps.h"
+#include "BoundaryQuadTree.h"
+#include "BoundarySampler.h"
+#include "HoleLayers.h"
+#include "MultigridSolver.h"
+#include "ParallelFor.h"
+#include "PixelBitmap.h"
+#include "SimdWeightKernel.h"
+#include "WeightTable.h"
+
 #define CONNECTIVITY_OPTION_1 4
 #define CONNECTIVITY_OPTION_2 8
 #define HOLE_VALUE -1
+// The amount of channels of the CV_32FC3 images filled in color mode.
+#define COLOR_CHANNELS 3
 #define ALGORITHM_OPTION_ONE 1
 #define ALGORITHM_OPTION_TWO 2
+#define ALGORITHM_OPTION_THREE 3
+#define ALGORITHM_OPTION_FOUR 4
+// The multigrid algorithm does not use the layers of ALGORITHM_OPTION_TWO,
+// so its fill is visibly different, see MultigridAlgorithm.
+#define ALGORITHM_OPTION_FIVE 5
+#define ALGORITHM_OPTION_AUTO 0
+
+// Holes with at most this many hole * boundary pixel pairs use the regular
+// algorithm in ALGORITHM_OPTION_AUTO.
+#define AUTO_REGULAR_MAX_PAIRS (1 << 22)
+// Larger holes with at most this many pixels in their bounding box use the
+// FFT algorithm, and the rest the hierarchical algorithm.
+#define AUTO_FFT_MAX_AREA (1 << 22)
 
 #define APPROXIMATE_ALGORITHM_ROUTINE_AMOUNT 100
+// The approximate algorithm stops sweeping over a hole when no pixel changed
+// by more than this in a sweep.
+#define DEFAULT_RESIDUAL_TOLERANCE 0.0
+#define DEFAULT_APPROXIMATION_TOLERANCE 0.05
+// The regular algorithm sums all the boundary pixels unless a sample budget
+// is set, see SetSampleBudget.
+#define DEFAULT_SAMPLE_BUDGET 0
 
 #define INDEX(i, j, cols) (((i) * (cols))+ (j))
 using namespace cv;
@@ -23,7 +59,127 @@ using namespace cv;
  * @brief Alias for a pair of integers representing an (x, y) coordinate.
  */
 using Pixel = std::pair<int, int>;
-typedef std::function<double (Pixel, Pixel, int, double)> WeightFunctionType;
+
+/**
+ * @brief Inclusive bounds of the coordinates of a set of pixels.
+ */
+struct PixelBounds {
+  int minX;
+  int minY;
+  int maxX;
+  int maxY;
+};
+
+/**
+ * @brief The pixels of a single hole and of its boundary.
+ */
+struct HoleRegion {
+  std::vector<Pixel> holePixels;
+  std::vector<Pixel> boundaryCoordinates;
+  // The values of every channel of a boundary pixel, one after the other.
+  std::vector<float> boundaryValues;
+  PixelBounds bounds;
+};
+
+/**
+ * @brief The part of the FFT algorithm for a hole that does not depend on
+ * the image values: the spectrum of the weight kernel and the divisor sums,
+ * the normalizers of the hole pixels, over the padded hole bounding box.
+ */
+struct FftKernel {
+  int minX;
+  int minY;
+  int dftX;
+  int dftY;
+  Mat kernelSpectrum;
+  Mat divisorSums;
+};
+
+/**
+ * @brief A hole of a FillPlan, with the algorithm chosen for it and what
+ * this algorithm needs that does not depend on the image values.
+ */
+struct PlannedHole {
+  // The hole and its boundary, without the boundary values.
+  HoleRegion region;
+  int algorithm;
+  // The layers of the hole pixels, for ALGORITHM_OPTION_TWO.
+  HoleLayers layers;
+  // For ALGORITHM_OPTION_THREE.
+  FftKernel fftKernel;
+};
+
+/**
+ * FillStatistics holds the time spent in every stage of the last call of
+ * HoleFiller::FillImage, FillImageInPlace or CreatePlan, and counters of
+ * the work done.
+ */
+struct FillStatistics {
+  // Finding the holes of the image and their boundaries.
+  double findHolesSeconds = 0;
+  // Preparing the holes for the fill: the layers of the approximate
+  // algorithm and the kernel of the FFT algorithm.
+  double prepareSeconds = 0;
+  // Filling the hole pixels.
+  double fillSeconds = 0;
+  std::size_t holesAmount = 0;
+  std::size_t holePixelsAmount = 0;
+  std::size_t boundaryPixelsAmount = 0;
+  // The weights computed or read from a WeightTable, one per hole and
+  // boundary pixel pair of the regular algorithm (per summed or sampled
+  // boundary pixel and far cell with a sample budget), per quadtree node or
+  // boundary pixel of the hierarchical one, per kernel offset of the FFT
+  // one, and per neighbor of every hole pixel in every approximate sweep.
+  long long weightEvaluations = 0;
+  // The sweeps of the approximate algorithm, over all the holes.
+  int sweepsAmount = 0;
+  // The layers of the approximate algorithm, over all the holes.
+  int layersAmount = 0;
+};
+
+/**
+ * FillPlan holds the analysis of the holes of a mask, made once by
+ * HoleFiller::CreatePlan: the hole and boundary pixels of every hole, the
+ * algorithm chosen for it, the layers of the approximate algorithm and the
+ * kernel spectrum and normalizers of the FFT algorithm. HoleFiller::FillImage
+ * then fills any number of images of the same size with these holes, doing
+ * only the work that depends on their values. Filling does not change the
+ * plan, so HoleFillers on different threads can share it.
+ */
+class FillPlan {
+ public:
+  FillPlan ();
+
+  /**
+   * @brief Returns the number of rows of the images the plan fills.
+   */
+  int Rows () const;
+
+  /**
+   * @brief Returns the number of columns of the images the plan fills.
+   */
+  int Cols () const;
+
+  /**
+   * @brief Returns the number of holes of the plan.
+   */
+  std::size_t HolesAmount () const;
+
+ private:
+  friend class HoleFiller;
+
+  int rows_;
+  int cols_;
+  int z_;
+  double epsilon_;
+  int connectivity_;
+  std::vector<PlannedHole> holes_;
+};
+
+/**
+ * @brief Alias for a function choosing the algorithm of a hole.
+ */
+typedef std::function<int (const HoleRegion &)> AlgorithmSelectorType;
 
 /**
  * HoleFiller class is used for filling the holes in an image using different
@@ -35,31 +191,205 @@ class HoleFiller {
   double epsilon_;
   int connectivity_;
   int algorithmType;
+  int threadCount_;
+  int channels_;
+  double approximationTolerance_;
+  int sampleBudget_;
+  double residualTolerance_;
+  int maxSweeps_;
+  bool coloredSweeps_;
+  int sweepsAmount_;
+  double residual_;
+  FillStatistics statistics_;
   WeightFunctionType weightFunc_;
+  AlgorithmSelectorType algorithmSelector_;
 
   //Data structures
-  std::unordered_set<int> visitedSet;
+  PixelBitmap maskBitmap_;
+  PixelBitmap holeBitmap_;
+  std::vector<HoleRegion> holeRegions_;
   std::vector<Pixel> holePixelsVector_;
   std::vector<Pixel> boundaryPixelsCoordinatesVector_;
   std::vector<float> boundaryPixelsValuesVector_;
-  std::unordered_map<int, int> layerMap;
-  std::map<int, std::vector<Pixel>> layerMapReverse;
-  std::vector<Pixel> curLayerVector;
-  std::vector<Pixel> tempLayerVector;
+  BoundarySoA boundarySoA_;
+  std::shared_ptr<const WeightTable> weightTable_;
+  HoleLayers layers_;
+  FftKernel fftKernel_;
 
  public:
 
   /**
    * @brief Constructor for the HoleFiller class.
+   *
+   * @param thread_count The number of threads the parallel algorithms use.
    */
    HoleFiller (const int z, const double epsilon, const int connectivity,
-              const int algorithm_type, const WeightFunctionType &weight_func);
+              const int algorithm_type, const WeightFunctionType &weight_func,
+              const int thread_count = 1);
   /**
-   * @brief This function fills the hole region in the input image.
+   * @brief This function fills the hole regions in the input image. Every
+   * connected hole is filled on its own, using only its own boundary.
+   *
+   * A CV_32FC3 image is filled in color mode: hole pixels have HOLE_VALUE in
+   * their first channel, and every weight is computed once for the three
+   * channels.
+   *
+   * @param image A CV_32FC1 or CV_32FC3 image.
    */
    Mat FillImage (const Mat &image);
 
+  /**
+   * @brief Fills the hole regions of an image like FillImage, writing the
+   * filled values to the image itself instead of to a copy. The image may
+   * be a region of interest of a larger image, e.g. the one given by
+   * ImageMasker::GetHoleRoi, so that only the bounding box of the holes
+   * and their boundary ring is searched and filled. Pixel coordinates are
+   * then relative to the region, which gives the same result for weight
+   * functions of the distance between pixels.
+   *
+   * @param image A CV_32FC1 or CV_32FC3 image.
+   */
+   void FillImageInPlace (Mat &image);
+
+  /**
+   * @brief Finds the holes of an image and prepares everything about them
+   * that does not depend on the image values, to fill many images with the
+   * same holes by FillImage (image, plan). The algorithm of every hole is
+   * chosen here, as in FillImage.
+   *
+   * @param image A CV_32FC1 or CV_32FC3 image with the holes, e.g. the
+   * output of ImageMasker::ApplyMask for the mask.
+   *
+   * @return The plan, to be filled by a HoleFiller with the same parameters.
+   */
+   FillPlan CreatePlan (const Mat &image);
+
+  /**
+   * @brief Fills the holes of a plan in an image, with the same result as
+   * FillImage for an image with these holes. The hole pixels are filled
+   * whatever their values, and the boundary values are read from the image.
+   *
+   * @param image A CV_32FC1 or CV_32FC3 image of the size of the plan.
+   * @param plan A plan from CreatePlan.
+   *
+   * @return The filled image, or an empty Mat if the plan was made for
+   * another image size, z, epsilon or connectivity.
+   */
+   Mat FillImage (const Mat &image, const FillPlan &plan);
+
+  /**
+   * @brief Fills the holes of a plan in an image like FillImage (image,
+   * plan), but the hole pixels of the approximate algorithm start from the
+   * values of an initial image, e.g. the filled previous frame of a video,
+   * instead of HOLE_VALUE. The sweeps converge to the same values, and with
+   * a positive residual tolerance stop sooner the closer the initial values
+   * are, see SetConvergenceCriteria.
+   *
+   * @param image A CV_32FC1 or CV_32FC3 image of the size of the plan.
+   * @param plan A plan from CreatePlan.
+   * @param initialImage An image of the size and type of image, or an empty
+   * Mat to start from HOLE_VALUE.
+   *
+   * @return The filled image, or an empty Mat if the plan was made for
+   * another image size, z, epsilon or connectivity, or the initial image
+   * does not match the image.
+   */
+   Mat FillImage (const Mat &image, const FillPlan &plan,
+                  const Mat &initialImage);
+
+  /**
+   * @brief Sets the function choosing the algorithm of every hole when the
+   * algorithm type is ALGORITHM_OPTION_AUTO. By default small holes use the
+   * regular algorithm, larger ones the FFT algorithm and holes with huge
+   * bounding boxes the hierarchical algorithm. The FFT and hierarchical
+   * algorithms assume a weight depending only on the offset between the two
+   * pixels, so without a selector every hole of another weight function
+   * than MyWeightFunction::GetWeight uses the regular algorithm, and a
+   * selector should only pick them for such weights.
+   *
+   * @param algorithm_selector The function, returning an algorithm option.
+   */
+   void SetAlgorithmSelector (const AlgorithmSelectorType &algorithm_selector);
+
+  /**
+   * @brief Sets the error tolerance of the hierarchical algorithm
+   * (ALGORITHM_OPTION_FOUR), DEFAULT_APPROXIMATION_TOLERANCE by default.
+   *
+   * A boundary cluster is used as a whole when the relative error of
+   * replacing it by its centroid, about (z * size / distance)^2 / 2, is
+   * below the tolerance. A tolerance of 0 gives the exact regular algorithm
+   * result.
+   *
+   * @param tolerance The error tolerance, non negative.
+   */
+   void SetApproximationTolerance (double tolerance);
+
+  /**
+   * @brief Sets the sample budget of the regular algorithm
+   * (ALGORITHM_OPTION_ONE), DEFAULT_SAMPLE_BUDGET by default.
+   *
+   * With a positive budget, holes with more boundary pixels than the budget
+   * are filled from a BoundarySampler: the boundary pixels near a hole
+   * pixel are summed exactly, and about `sample_budget` of the far ones are
+   * sampled, at least one per far cell of the sampler. The relative error
+   * of the far part of the sums shrinks at least as 1 / sqrt
+   * (sample_budget). The sampled sums are not vectorized, so for grayscale
+   * images they only pay off over the SimdWeightKernel for boundaries of
+   * many thousands of pixels. A budget of 0 gives the exact result.
+   *
+   * @param sample_budget The number of far boundary pixels to sample per
+   * hole pixel, non negative.
+   */
+   void SetSampleBudget (int sample_budget);
+
+  /**
+   * @brief Sets when the approximate algorithm (ALGORITHM_OPTION_TWO) stops
+   * sweeping over a hole: after a sweep in which no pixel changed by more
+   * than the residual tolerance, or after the maximum number of sweeps. By
+   * default DEFAULT_RESIDUAL_TOLERANCE and
+   * APPROXIMATE_ALGORITHM_ROUTINE_AMOUNT.
+   *
+   * @param residual_tolerance The residual tolerance, non negative.
+   * @param max_sweeps The maximum number of sweeps, positive.
+   */
+   void SetConvergenceCriteria (double residual_tolerance, int max_sweeps);
+
+  /**
+   * @brief Sets whether the approximate algorithm sweeps over the hole pixels
+   * color by color, updating the pixels of a color concurrently with the
+   * thread count given to the constructor, instead of layer by layer. See
+   * RunSweeps. The result is the same for any thread count, but differs
+   * slightly from the one of layer by layer sweeps. False by default.
+   *
+   * @param colored True for colored sweeps.
+   */
+   void SetColoredSweeps (bool colored);
+
+  /**
+   * @brief Returns the largest number of sweeps the approximate algorithm
+   * ran over a hole in the last FillImage call, 0 if it filled no hole.
+   */
+   int GetSweepsAmount () const;
+
+  /**
+   * @brief Returns the largest residual, the maximal change of a pixel in
+   * the last sweep, of the holes the approximate algorithm filled in the
+   * last FillImage call.
+   */
+   double GetResidual () const;
+
+  /**
+   * @brief Returns the stage times and counters of the last FillImage,
+   * FillImageInPlace or CreatePlan call. Filling with a plan only has fill
+   * times, the other stages being done by CreatePlan.
+   */
+   const FillStatistics &GetStatistics () const;
+
  private:
+  // Keeps the holes of an image between mask edits and refills them with
+  // the search and the fills of the filler.
+  friend class IncrementalFiller;
+
   /**
    * @brief This function returns the coordinates of a neighbor pixel
    * of a given pixel based on its index.
@@ -70,64 +400,253 @@ class HoleFiller {
    Pixel GetNeighborPixel (const Pixel currentPixel, int index);
 
   /**
-   * @brief This function finds the pixels belonging to the hole region and
-   * the boundary region.
-   * @param image The input image containing a hole that needs to be filled.
+   * @brief This function finds all the holes of the image and their
+   * boundaries, in one pass, and saves them to `holeRegions_`.
+   * @param image The input image containing holes that need to be filled.
    */
    void FindHoleAndBoundaryPixels (const Mat &image);
 
   /**
-   * @brief This function finds the first pixel belonging to the hole region
-   * and returning it.
-   * @param image The input image containing a hole that needs to be filled.
+   * @brief Finds the hole of a pixel of `maskBitmap_` and its boundary, as
+   * FindHoleAndBoundaryPixels does for every hole. The hole pixels are
+   * cleared from `maskBitmap_`.
+   *
+   * @param image The input image, for the boundary values.
+   * @param firstPixel A pixel of the hole, set in `maskBitmap_`.
+   * @param region Output for the hole and its boundary.
+   */
+   void FindHoleRegion (const Mat &image, const Pixel &firstPixel,
+                        HoleRegion &region);
+
+  /**
+   * @brief Returns the algorithm to fill a hole with: the algorithm type
+   * given to the constructor, or for ALGORITHM_OPTION_AUTO the one chosen by
+   * `algorithmSelector_` or by the default policy.
+   *
+   * @param region The hole.
+   */
+   int SelectAlgorithm (const HoleRegion &region) const;
+
+  /**
+   * @brief Fills the hole currently loaded to the hole and boundary vectors.
+   *
+   * @param image The input image.
+   * @param filledImage The output image with the hole filled.
+   * @param algorithm The algorithm to use.
+   */
+   void FillHole (const Mat &image, Mat &filledImage, int algorithm);
+
+  /**
+   * @brief Loads a hole to the hole and boundary vectors and fills it in
+   * place. The region is given back its pixels afterwards.
+   *
+   * @param image The image, with HOLE_VALUE in the hole pixels.
+   * @param region The hole.
+   * @param algorithm The algorithm to use.
+   */
+   void FillRegion (Mat &image, HoleRegion &region, int algorithm);
+
+  /**
+   * @brief Fills the hole of a plan currently loaded to the hole and
+   * boundary vectors, with the layers or the FFT kernel of the plan.
+   *
+   * @param image The input image.
+   * @param filledImage The output image with the hole filled.
+   * @param hole The hole of the plan.
+   */
+   void FillPlannedHole (const Mat &image, Mat &filledImage,
+                         const PlannedHole &hole);
+
+  /**
+   * @brief Packs the pixels of an image with HOLE_VALUE in their first
+   * channel to `maskBitmap_`, one bit per pixel.
+   *
+   * @param image The input image.
+   */
+   void SetMaskBitmap (const Mat &image);
+
+  /**
+   * @brief Adds the hole and boundary pixels of the hole currently loaded
+   * to the hole and boundary vectors to `statistics_`.
    */
-   Pixel FindFirstHolePixel (const Mat &image);
+   void CountHolePixels ();
 
   /**
-   * @brief FloodFill - A function that recursively searches for hole and boundary pixels
-   *                     using the flood fill algorithm and saves them in different vectors.
+   * @brief FloodFill - A function that moves the pixels of the hole
+   * containing a given pixel from `maskBitmap_` to `holeBitmap_`.
    *
-   * @param image The input image to search for hole and boundary pixels.
-   * @param currentPixel The current pixel being evaluated during the recursive search.
+   * The fill is a scanline fill: every seed grows to the whole span of hole
+   * pixels in its row, and the rows above and below the span get one seed
+   * per run of unvisited hole pixels. Seeds live in a vector on the heap,
+   * so the stack use does not grow with the hole size.
+   *
+   * @param firstPixel A pixel of the hole.
+   *
+   * @return The bounds of the hole.
    */
-   void FloodFill (const Mat &image, Pixel currentPixel);
+   PixelBounds FloodFill (Pixel firstPixel);
+
+  /**
+   * @brief Saves the hole pixels marked in `holeBitmap_` and the pixels
+   * bordering them to a HoleRegion, in row-major order. The boundary is
+   * found a word of `holeBitmap_` at a time, see
+   * PixelBitmap::GetBoundaryWord. The hole pixels are then cleared from
+   * `holeBitmap_`, to leave it empty for the next hole.
+   *
+   * @param image The input image, for the boundary values.
+   * @param holeBounds The bounds of the hole.
+   * @param region Output for the hole and its boundary.
+   */
+   void CollectHoleAndBoundaryPixels (const Mat &image,
+                                      const PixelBounds &holeBounds,
+                                      HoleRegion &region);
 
   /**
    * @brief This function fills a hole in an image using the regular algorithm.
    *
+   * Hole pixels are independent of each other, so they are split between
+   * `threadCount_` threads, each writing its own pixels of `filledImage`.
+   * With the MyWeightFunction weight the boundary is copied to
+   * `boundarySoA_` and accumulated by the SimdWeightKernel, or, on CPUs
+   * without SIMD support, filled by the SpecializedHoleFiller for z.
+   *
    * @param image The input image containing a hole that needs to be filled.
    * @param filledImage The output image with the hole filled.
    */
    void RegularAlgorithm (const Mat &image, Mat &filledImage);
 
   /**
-   * @brief This function sets layers for the hole pixels using boundary pixels.
-   * It saves the pixels of each layer to the `layerMapReverse` and `layerMap`
-   * data structures.
+   * @brief This function fills a single hole pixel using the regular
+   * algorithm, as the weighted average of all the boundary pixels. When
+   * `boundarySoA_` is set and its float weights do not underflow, the sums
+   * come from the SimdWeightKernel, otherwise from `weightFunc_`.
    *
-   * @param image The input image
+   * @param holePixel The coordinates of the hole pixel to fill.
+   * @param filledImage The output image with the hole filled.
    */
-   void SetLayers (const Mat &image);
+   void RegularAlgorithmPixel (const Pixel &holePixel, Mat &filledImage);
 
   /**
-   * @brief SetLayerHelper - A helper function for the SetLayer function that sets the layer of
-   *                         the pixels connected to the current pixel recursively.
+   * @brief Adds the weighted boundary values and the weights of the
+   * boundary pixels for a single hole pixel, see RegularAlgorithmPixel.
    *
-   * @param image The input image to set the layer of connected pixels.
-   * @param currentPixel The current pixel being evaluated during the recursive search.
-   * @param curLayer The current layer to assign to the pixels being evaluated.
+   * @param holePixel The coordinates of the hole pixel.
+   * @param dividendSums The sums of the weighted values of every channel.
+   * @param divisorSum A reference to the sum of the weights.
+   */
+   void AccumulateRegularPixel (const Pixel &holePixel, double *dividendSums,
+                                double &divisorSum) const;
+
+  /**
+   * @brief Picks the kernel of the regular algorithm for the hole currently
+   * loaded to the hole and boundary vectors: `boundarySoA_` for the
+   * SimdWeightKernel, the SpecializedHoleFiller for z, or `weightTable_`.
+   *
+   * @param specializedCall The call run for the SpecializedHoleFiller, see
+   * DispatchDistancePowerSpecialization.
+   *
+   * @return True if the call was run, otherwise the hole pixels are left to
+   * AccumulateRegularPixel.
    */
-   void SetLayerHelper (const Mat &image, Pixel currentPixel, int curLayer);
+   template <typename Call>
+   bool RunRegularKernel (const Call &specializedCall);
 
   /**
-   * @brief SetLayer - Sets the layer of the current pixel if it is a hole and
-   * has not been assigned a layer before.
+   * @brief Adds the regular algorithm sums of boundary pixels, times a sign,
+   * to the sums of hole pixels, with the kernels of RegularAlgorithm. The
+   * sums are linear in the boundary, so those of a boundary edit update the
+   * sums of a whole boundary.
    *
-   * @param image The input image to set the layer of the current pixel.
-   * @param currentPixel The current pixel being evaluated for layer assignment.
-   * @param currentLayer The current layer to assign to the current pixel.
+   * @param holePixels The coordinates of the hole pixels.
+   * @param boundaryCoordinates The coordinates of the boundary pixels.
+   * @param boundaryValues The values of every channel of the boundary
+   * pixels, one after the other.
+   * @param sign 1 to add the boundary pixels, -1 to subtract them.
+   * @param dividendSums The CV_64F sums of the weighted values of every
+   * channel of every pixel of the image.
+   * @param divisorSums The CV_64FC1 sums of the weights of every pixel of
+   * the image.
    */
-   void SetLayer (const Mat &image, Pixel currentPixel, int currentLayer);
+   void AccumulateRegularSums (const std::vector<Pixel> &holePixels,
+                               const std::vector<Pixel> &boundaryCoordinates,
+                               const std::vector<float> &boundaryValues,
+                               double sign, Mat &dividendSums,
+                               Mat &divisorSums);
+
+  /**
+   * @brief This function fills a hole in an image like the regular
+   * algorithm, with sums estimated by a BoundarySampler of `sampleBudget_`
+   * samples per hole pixel. The samples of a pixel only depend on its
+   * coordinates, so the result does not depend on `threadCount_`.
+   *
+   * @param filledImage The output image with the hole filled.
+   */
+   void SampledRegularAlgorithm (Mat &filledImage);
+
+  /**
+   * @brief This function fills a hole in an image with the same result as the
+   * regular algorithm, computed with FFT based convolutions.
+   *
+   * The weight only depends on the offset between the hole pixel and the
+   * boundary pixel, so for every hole pixel the dividend and the divisor of
+   * the regular algorithm are the convolutions of the boundary values image
+   * and of the boundary indicator image with a single weight kernel. Both are
+   * computed over the hole bounding box padded by the kernel extent, which
+   * costs O(N log N) instead of O(holes * boundary).
+   *
+   * @param fftKernel The kernel of the hole, from PrepareFftAlgorithm.
+   * @param filledImage The output image with the hole filled.
+   */
+   void FftAlgorithm (const FftKernel &fftKernel, Mat &filledImage);
+
+  /**
+   * @brief Computes the part of the FFT algorithm that only depends on the
+   * hole and boundary pixels: the weight kernel spectrum and the divisor
+   * sums.
+   *
+   * @param fftKernel Output for the kernel of the hole.
+   */
+   void PrepareFftAlgorithm (FftKernel &fftKernel);
+
+  /**
+   * @brief This function fills a hole in an image by approximating the
+   * regular algorithm with a BoundaryQuadTree over the boundary pixels.
+   *
+   * Far away clusters of boundary pixels contribute through their aggregate
+   * value and weight mass, which brings the O(holes * boundary) cost of the
+   * regular algorithm down to about O(holes * log(boundary)). The opening
+   * angle is derived from `approximationTolerance_`.
+   *
+   * @param image The input image containing a hole that needs to be filled.
+   * @param filledImage The output image with the hole filled.
+   */
+   void HierarchicalAlgorithm (const Mat &image, Mat &filledImage);
+
+  /**
+   * @brief This function fills a hole in an image with a MultigridSolver:
+   * every hole pixel becomes the weighted average of all its neighbors.
+   *
+   * Unlike the approximate algorithm, neighbors of a later layer are not left
+   * out, so this is the solution of the symmetric system the approximate
+   * sweeps would converge to without the layer order, reached in a fixed
+   * number of V-cycles however wide the hole is. It is not a faster way to
+   * the approximate algorithm fill: the layers carry the boundary values
+   * inwards, while averaging all the neighbors smooths them out, so the two
+   * fills of a wide hole differ by a large part of the value range.
+   *
+   * @param filledImage The output image with the hole filled.
+   */
+   void MultigridAlgorithm (Mat &filledImage);
+
+  /**
+   * @brief This function sets layers for the hole pixels using boundary pixels.
+   * It saves the layer of every pixel in the bounds of the hole, and the
+   * pixels of each layer. The work is done by the Neighborhood
+   * specialization of the connectivity.
+   *
+   * @param layers Output layers of the hole pixels.
+   */
+   void SetLayers (HoleLayers &layers);
 
   /**
    * @brief Fills the hole in the input image using the Approximate Algorithm.
@@ -139,35 +658,82 @@ class HoleFiller {
    *    within a specified maximum layer number.
    * 3. Set the filled value of the hole pixel to be the average calculated in step 2.
    *
-   * @param image The input image with holes to be filled.
+   * The sweeps stop when no pixel changed by more than the residual tolerance,
+   * or after the maximum number of sweeps, see SetConvergenceCriteria.
+   *
+   * With the MyWeightFunction weight and a small integer z, the
+   * SpecializedHoleFiller for z and the connectivity does the work.
+   *
+   * @param layers The layers of the hole pixels, from SetLayers.
    * @param filledImage The output image with holes filled using the Approximate Algorithm.
    */
-   void ApproximateAlgorithm (const Mat &image, Mat &filledImage);
+   void ApproximateAlgorithm (const HoleLayers &layers, Mat &filledImage);
 
   /**
    * @brief This function calculates the affect of a boundary pixel on a hole pixel, up to a specified layer number.
    *
+   * @param layers The layers of the hole pixels.
    * @param image The input image matrix.
    * @param holePixel The coordinates of the hole pixel.
    * @param maximumLayerNumber The maximum layer number up to which to check for pixel affectation.
    * @param boundaryPixel The coordinates of the boundary pixel.
    * @param dividendSum A reference to the sum of dividend values for the current hole pixel.
+   * @param dividendSums The sums of dividend values of every channel for the current hole pixel.
    * @param divisorSum A reference to the sum of divisor values for the current hole pixel.
    */
-   void CalculatePixelAffect (const Mat &image,
+   void CalculatePixelAffect (const HoleLayers &layers, const Mat &image,
                              const Pixel &holePixel, int maximumLayerNumber,
-                             const Pixel &boundaryPixel, double &dividendSum,
+                             const Pixel &boundaryPixel, double *dividendSums,
                              double &divisorSum);
   /**
    * @brief This function determines if a given pixel affects a hole area
    * up to a specified layer number.
    *
+   * @param layers The layers of the hole pixels.
    * @param image The input image matrix.
    * @param pixel The coordinates of the pixel to be checked.
    * @param maximumLayerNumber The maximum layer number up to which to check for
    * pixel affectation.
    */
-   bool IsPixelAffecting (const Mat &image, Pixel pixel, int maximumLayerNumber);
+   bool IsPixelAffecting (const HoleLayers &layers, const Mat &image,
+                          Pixel pixel, int maximumLayerNumber);
+
+  /**
+   * @brief Checks if a pixel of an image is a hole pixel.
+   */
+   bool IsHoleValue (const Mat &image, int x, int y) const;
+
+  /**
+   * @brief Checks if `weightFunc_` is MyWeightFunction::GetWeight, whose
+   * closed form lets the filler use specialized kernels.
+   */
+   bool IsDistancePowerWeight () const;
+
+  /**
+   * @brief Returns the bounds of the hole pixels and the boundary pixels.
+   */
+   PixelBounds GetHoleBounds () const;
+
+  /**
+   * @brief Points `weightTable_` to the shared WeightTable of (z, epsilon)
+   * covering the given offsets. Only done for the MyWeightFunction weight,
+   * the only one known to depend on the absolute offset alone.
+   *
+   * @param extentX The largest absolute x offset to cover.
+   * @param extentY The largest absolute y offset to cover.
+   */
+   void AcquireWeightTable (int extentX, int extentY);
+
+  /**
+   * @brief Returns the weight of two pixels, from `weightTable_` when it is
+   * set and covers their offset, otherwise from `weightFunc_`.
+   */
+   double GetWeight (const Pixel &p1, const Pixel &p2) const;
+
+  /**
+   * @brief Clears the internal data structures of the hole being filled.
+   */
+    void ClearHoleFields ();
 
   /**
    * @brief Clears all internal data structures used by the hole filling algorithm.
@@ -175,3 +741,5 @@ class HoleFiller {
     void ClearFields ();
 
 };
+
+#endif // HOLE_FILLER_H
@@ -0,0 +1,201 @@
+#include "HoleFillerApi.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "HoleFiller.h"
+#include "ImageMasker.h"
+#include "MyWeightFunction.h"
+
+#define MSG_STATUS_OK "The holes were filled."
+#define MSG_STATUS_NULL_ARGUMENT "A pointer argument is null."
+#define MSG_STATUS_BUFFER "A buffer has no data, an unknown format, or a stride too small for its width."
+#define MSG_STATUS_SIZE "The image and the mask have different sizes."
+#define MSG_STATUS_PARAMETERS "Invalid z, epsilon, connectivity, algorithm or thread count."
+#define MSG_STATUS_INTERNAL "The fill failed."
+#define MSG_STATUS_UNKNOWN "Unknown status."
+
+namespace {
+
+/**
+ * @brief Returns the OpenCV type of a buffer format, or -1 for an unknown
+ * format.
+ */
+int GetBufferType (const int format)
+{
+  switch (format)
+    {
+      case HOLE_FILLER_FORMAT_GRAY8:
+        return CV_8UC1;
+
+      case HOLE_FILLER_FORMAT_BGR8:
+        return CV_8UC3;
+
+      case HOLE_FILLER_FORMAT_GRAY32F:
+        return CV_32FC1;
+
+      case HOLE_FILLER_FORMAT_BGR32F:
+        return CV_32FC3;
+    }
+
+  return -1;
+}
+
+/**
+ * @brief Checks if a buffer has data, a known format and rows at least as
+ * long as its width.
+ */
+bool IsValidBuffer (const HoleFillerBuffer &buffer)
+{
+  int type = GetBufferType (buffer.format);
+  return buffer.data != nullptr && type >= 0 && buffer.width > 0
+         && buffer.height > 0
+         && buffer.stride >= (ptrdiff_t) (buffer.width * CV_ELEM_SIZE (type));
+}
+
+bool IsValidParameters (const HoleFillerParameters &parameters)
+{
+  return parameters.epsilon > 0 && parameters.threads > 0
+         && (parameters.connectivity == CONNECTIVITY_OPTION_1
+             || parameters.connectivity == CONNECTIVITY_OPTION_2)
+         && parameters.algorithm >= ALGORITHM_OPTION_AUTO
+         && parameters.algorithm <= ALGORITHM_OPTION_FIVE;
+}
+
+/**
+ * @brief Returns a Mat header over a buffer, sharing its data.
+ */
+Mat WrapBuffer (const HoleFillerBuffer &buffer)
+{
+  return Mat (buffer.height, buffer.width, GetBufferType (buffer.format),
+              buffer.data, (std::size_t) buffer.stride);
+}
+
+/**
+ * @brief Sets all the channels of the hole pixels of a float image to
+ * HOLE_VALUE.
+ */
+void SetHoleValues (Mat &image, const Mat &mask)
+{
+  const int channels = image.channels ();
+  std::vector<uchar> holes (image.cols);
+  for (int i = 0; i < image.rows; ++i)
+    {
+      ImageMasker::GetHoleRow (mask, i, holes.data ());
+      float *values = image.ptr<float> (i);
+      for (int j = 0; j < image.cols; ++j)
+        {
+          if (!holes[j]) continue;
+
+          std::fill (values + j * channels, values + (j + 1) * channels,
+                     (float) HOLE_VALUE);
+        }
+    }
+}
+
+/**
+ * @brief Writes the hole pixels of a filled float image to an 8-bit image
+ * with the same channels.
+ */
+void CopyHolePixels (const Mat &filledImage, const Mat &mask, Mat &image)
+{
+  const int channels = image.channels ();
+  std::vector<uchar> holes (image.cols);
+  for (int i = 0; i < image.rows; ++i)
+    {
+      ImageMasker::GetHoleRow (mask, i, holes.data ());
+      const float *filled = filledImage.ptr<float> (i);
+      uchar *values = image.ptr<uchar> (i);
+      for (int j = 0; j < image.cols; ++j)
+        {
+          if (!holes[j]) continue;
+
+          for (int c = j * channels; c < (j + 1) * channels; ++c)
+            {
+              values[c] = saturate_cast<uchar> (filled[c]);
+            }
+        }
+    }
+}
+
+}
+
+int HoleFillerFill (const HoleFillerParameters *parameters,
+                    const HoleFillerBuffer *image,
+                    const HoleFillerBuffer *mask)
+{
+  if (parameters == nullptr || image == nullptr || mask == nullptr)
+    return HOLE_FILLER_ERROR_NULL_ARGUMENT;
+  if (!IsValidBuffer (*image) || !IsValidBuffer (*mask))
+    return HOLE_FILLER_ERROR_BUFFER;
+  if (image->width != mask->width || image->height != mask->height)
+    return HOLE_FILLER_ERROR_SIZE;
+  if (!IsValidParameters (*parameters)) return HOLE_FILLER_ERROR_PARAMETERS;
+
+  // No exception may cross the C interface. ParallelFor rethrows those of
+  // the worker threads here.
+  try
+    {
+      Mat imageMat = WrapBuffer (*image);
+      Mat maskMat = WrapBuffer (*mask);
+
+      Rect holeRoi = ImageMasker::GetHoleRoi (maskMat);
+      if (holeRoi.empty ()) return HOLE_FILLER_OK;
+
+      Mat imageRegion = imageMat (holeRoi);
+      Mat maskRegion = maskMat (holeRoi);
+      HoleFiller holeFiller (parameters->z, parameters->epsilon,
+                             parameters->connectivity, parameters->algorithm,
+                             &MyWeightFunction::GetWeight,
+                             parameters->threads);
+
+      if (imageRegion.depth () == CV_32F)
+        {
+          SetHoleValues (imageRegion, maskRegion);
+          holeFiller.FillImageInPlace (imageRegion);
+        }
+      else
+        {
+          Mat filledRegion =
+              (imageRegion.channels () == 1)
+              ? ImageMasker::ApplyMask (imageRegion, maskRegion,
+                                        parameters->threads)
+              : ImageMasker::ApplyMaskColor (imageRegion, maskRegion,
+                                             parameters->threads);
+          holeFiller.FillImageInPlace (filledRegion);
+          CopyHolePixels (filledRegion, maskRegion, imageRegion);
+        }
+    }
+  catch (...)
+    {
+      return HOLE_FILLER_ERROR_INTERNAL;
+    }
+
+  return HOLE_FILLER_OK;
+}
+
+const char *HoleFillerGetStatusMessage (const int status)
+{
+  switch (status)
+    {
+      case HOLE_FILLER_OK:
+        return MSG_STATUS_OK;
+
+      case HOLE_FILLER_ERROR_NULL_ARGUMENT:
+        return MSG_STATUS_NULL_ARGUMENT;
+
+      case HOLE_FILLER_ERROR_BUFFER:
+        return MSG_STATUS_BUFFER;
+
+      case HOLE_FILLER_ERROR_SIZE:
+        return MSG_STATUS_SIZE;
+
+      case HOLE_FILLER_ERROR_PARAMETERS:
+        return MSG_STATUS_PARAMETERS;
+
+      case HOLE_FILLER_ERROR_INTERNAL:
+        return MSG_STATUS_INTERNAL;
+    }
+
+  return MSG_STATUS_UNKNOWN;
+}
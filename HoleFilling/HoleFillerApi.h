@@ -0,0 +1,85 @@
+#ifndef HOLE_FILLER_API_H
+#define HOLE_FILLER_API_H
+
+#include <stddef.h>
+
+/* Pixel formats of the buffers. */
+#define HOLE_FILLER_FORMAT_GRAY8 1
+#define HOLE_FILLER_FORMAT_BGR8 2
+#define HOLE_FILLER_FORMAT_GRAY32F 3
+#define HOLE_FILLER_FORMAT_BGR32F 4
+
+/* Status codes of HoleFillerFill. */
+#define HOLE_FILLER_OK 0
+#define HOLE_FILLER_ERROR_NULL_ARGUMENT 1
+#define HOLE_FILLER_ERROR_BUFFER 2
+#define HOLE_FILLER_ERROR_SIZE 3
+#define HOLE_FILLER_ERROR_PARAMETERS 4
+#define HOLE_FILLER_ERROR_INTERNAL 5
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A pixel buffer owned by the caller. Row i starts stride * i bytes after
+ * data, and holds width pixels of the format, whose channels are
+ * interleaved.
+ */
+typedef struct HoleFillerBuffer {
+  void *data;
+  ptrdiff_t stride;
+  int width;
+  int height;
+  int format;
+} HoleFillerBuffer;
+
+/**
+ * The parameters of a fill, as the arguments of the HoleFilling executable.
+ */
+typedef struct HoleFillerParameters {
+  int z;
+  double epsilon;
+  /* 4 or 8. */
+  int connectivity;
+  /* 1 to 5, or 0 to choose per hole. */
+  int algorithm;
+  /* The number of threads to use, at least 1. */
+  int threads;
+} HoleFillerParameters;
+
+/**
+ * @brief Fills the holes of an image buffer in place.
+ *
+ * Only the bounding box of the holes and their boundary ring is read. A
+ * 32-bit float image is filled directly in the buffer, without any copy:
+ * its hole pixels are set to the hole value and then filled. An 8-bit
+ * image is filled through a float copy of that box, whose hole pixels are
+ * then written back, rounded and clamped to [0, 255]. All the channels of
+ * color images are filled, with the values of the grayscale formats in the
+ * range of the buffer, e.g. [0, 255] for both gray formats. Pixels outside
+ * the holes are never written, and pixels of float images outside the
+ * holes must not have the hole value -1.
+ *
+ * @param parameters The parameters of the fill.
+ * @param image The image to fill, of any format.
+ * @param mask The mask, of the size of the image: pixels of a
+ * HOLE_FILLER_FORMAT_GRAY8 mask below 128, or of a BGR8 mask whose gray
+ * value is below 128, or of a float mask below 0.5, are hole pixels.
+ *
+ * @return HOLE_FILLER_OK, or an error status.
+ */
+int HoleFillerFill (const HoleFillerParameters *parameters,
+                    const HoleFillerBuffer *image,
+                    const HoleFillerBuffer *mask);
+
+/**
+ * @brief Returns a message describing a status of HoleFillerFill.
+ */
+const char *HoleFillerGetStatusMessage (int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOLE_FILLER_API_H */
@@ -0,0 +1,36 @@
+#include "HoleLayers.h"
+
+HoleLayers::HoleLayers ()
+    : minX_ (0), minY_ (0), rows_ (0), cols_ (0), offsets_ (1, 0)
+{}
+
+void HoleLayers::Reset (const int minX, const int minY, const int maxX,
+                        const int maxY)
+{
+  minX_ = minX;
+  minY_ = minY;
+  rows_ = maxX - minX + 1;
+  cols_ = maxY - minY + 1;
+  grid_.assign ((std::size_t) rows_ * cols_, 0);
+  pixels_.clear ();
+  offsets_.assign (1, 0);
+}
+
+void HoleLayers::Clear ()
+{
+  minX_ = 0;
+  minY_ = 0;
+  rows_ = 0;
+  cols_ = 0;
+  std::vector<int> ().swap (grid_);
+  std::vector<std::pair<int, int>> ().swap (pixels_);
+  offsets_.assign (1, 0);
+}
+
+bool HoleLayers::EndLayer ()
+{
+  if (pixels_.size () == offsets_.back ()) return false;
+
+  offsets_.push_back (pixels_.size ());
+  return true;
+}
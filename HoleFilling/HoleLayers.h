@@ -0,0 +1,107 @@
+#ifndef HOLE_LAYERS_H
+#define HOLE_LAYERS_H
+
+#include <climits>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// The layer of a hole pixel that was not reached from the boundary yet.
+#define UNSET_LAYER INT_MAX
+
+/**
+ * HoleLayers stores the layers of the pixels of a hole for the approximate
+ * algorithm. The layers are kept in a dense grid over the bounds of the hole,
+ * addressed like Mat::at (x, y), where pixels that are not hole pixels are
+ * layer 0. The hole pixels are also bucketed by layer in a single array, with
+ * the offsets of the layers in a second one, so a sweep over the layers walks
+ * the pixels in order.
+ */
+class HoleLayers {
+ public:
+  HoleLayers ();
+
+  /**
+   * @brief Resizes the grid to the given inclusive bounds, sets all the
+   * pixels to layer 0 and removes all the layers.
+   */
+  void Reset (int minX, int minY, int maxX, int maxY);
+
+  /**
+   * @brief Releases the memory of the grid and of the layers.
+   */
+  void Clear ();
+
+  /**
+   * @brief Checks if a pixel is inside the grid.
+   */
+  bool Contains (const int x, const int y) const
+  {
+    return x >= minX_ && x < minX_ + rows_ && y >= minY_ && y < minY_ + cols_;
+  }
+
+  int Get (const int x, const int y) const
+  {
+    return grid_[GridIndex (x, y)];
+  }
+
+  void Set (const int x, const int y, const int layer)
+  {
+    grid_[GridIndex (x, y)] = layer;
+  }
+
+  /**
+   * @brief Adds a pixel to the last layer, which is not ended yet.
+   */
+  void AddPixel (const std::pair<int, int> &pixel)
+  {
+    pixels_.push_back (pixel);
+  }
+
+  /**
+   * @brief Ends the last layer, so the next pixels are added to a new one.
+   *
+   * @return False if the last layer is empty, in which case it is not kept.
+   */
+  bool EndLayer ();
+
+  /**
+   * @brief Returns the number of layers, the first layer is layer 1.
+   */
+  int LayersAmount () const
+  { return (int) offsets_.size () - 1; }
+
+  /**
+   * @brief Returns the pixels of all the layers, ordered by layer.
+   */
+  const std::vector<std::pair<int, int>> &Pixels () const
+  { return pixels_; }
+
+  /**
+   * @brief Returns the index in Pixels () of the first pixel of a layer.
+   */
+  std::size_t LayerBegin (const int layer) const
+  { return offsets_[layer - 1]; }
+
+  /**
+   * @brief Returns the index in Pixels () after the last pixel of a layer.
+   */
+  std::size_t LayerEnd (const int layer) const
+  { return offsets_[layer]; }
+
+ private:
+  int minX_;
+  int minY_;
+  int rows_;
+  int cols_;
+  std::vector<int> grid_;
+  std::vector<std::pair<int, int>> pixels_;
+  std::vector<std::size_t> offsets_;
+
+  std::size_t GridIndex (const int x, const int y) const
+  {
+    return ((std::size_t) (x - minX_) * cols_) + (y - minY_);
+  }
+};
+
+#endif // HOLE_LAYERS_H
@@ -1,30 +1,165 @@
 #include "ImageMasker.h"
 
-Mat ImageMasker::ApplyMask (const Mat &rgb_image, const Mat &mask)
+#include <algorithm>
+#include <vector>
+
+#include "ParallelFor.h"
+
+namespace {
+
+/**
+ * @brief Returns the gray value of a BGR pixel, rounded like cvtColor.
+ */
+inline int GetGrayValue (const uchar *bgr)
+{
+  return (bgr[0] * GRAY_WEIGHT_B + bgr[1] * GRAY_WEIGHT_G
+          + bgr[2] * GRAY_WEIGHT_R + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+}
+
+/**
+ * @brief Returns HOLE_VALUE for a hole pixel and the value otherwise,
+ * without a branch. Both products are exact, so the value is kept as is.
+ */
+inline float SelectValue (const float value, const uchar hole)
+{
+  return value * (float) (1 - hole) + (float) HOLE_VALUE * (float) hole;
+}
+
+}
+
+Mat ImageMasker::ApplyMask (const Mat &rgb_image, const Mat &mask,
+                            const int thread_count)
 {
-  Mat gray_image_;
-  // Convert the RGB image to grayscale
-  cvtColor (rgb_image, gray_image_, cv::COLOR_BGR2GRAY);
+  Mat masked_image (rgb_image.size (), CV_32F);
+  const int channels = rgb_image.channels ();
+  const int cols = rgb_image.cols;
 
-  // Create a new floating point matrix to store the masked values
-  Mat masked_image = Mat::zeros (gray_image_.size (), CV_32F);
+  ParallelFor (rgb_image.rows, thread_count,
+               [&] (std::size_t begin, std::size_t end)
+               {
+                 std::vector<uchar> holes (cols);
+                 for (std::size_t i = begin; i < end; ++i)
+                   {
+                     GetHoleRow (mask, (int) i, holes.data ());
+                     const uchar *pixels = rgb_image.ptr<uchar> ((int) i);
+                     float *masked = masked_image.ptr<float> ((int) i);
 
-  for (int i = 0; i < mask.rows; i++)
+                     if (channels == 1)
+                       {
+                         for (int j = 0; j < cols; ++j)
+                           {
+                             masked[j] = SelectValue (pixels[j], holes[j]);
+                           }
+                       }
+                     else
+                       {
+                         for (int j = 0; j < cols; ++j)
+                           {
+                             masked[j] = SelectValue (
+                                 (float) GetGrayValue (pixels + j * channels),
+                                 holes[j]);
+                           }
+                       }
+                   }
+               });
+
+  return masked_image;
+}
+
+Mat ImageMasker::ApplyMaskColor (const Mat &rgb_image, const Mat &mask,
+                                 const int thread_count)
+{
+  Mat masked_image (rgb_image.size (), CV_32FC3);
+  const int channels = rgb_image.channels ();
+  // A gray image gives the same value to the three channels.
+  const int channelStep = (channels == 1) ? 0 : 1;
+  const int cols = rgb_image.cols;
+
+  ParallelFor (rgb_image.rows, thread_count,
+               [&] (std::size_t begin, std::size_t end)
+               {
+                 std::vector<uchar> holes (cols);
+                 for (std::size_t i = begin; i < end; ++i)
+                   {
+                     GetHoleRow (mask, (int) i, holes.data ());
+                     const uchar *pixels = rgb_image.ptr<uchar> ((int) i);
+                     float *masked = masked_image.ptr<float> ((int) i);
+
+                     for (int j = 0; j < cols; ++j)
+                       {
+                         const uchar *pixel = pixels + j * channels;
+                         masked[j * 3] = SelectValue (pixel[0], holes[j]);
+                         masked[j * 3 + 1] =
+                             SelectValue (pixel[channelStep], holes[j]);
+                         masked[j * 3 + 2] =
+                             SelectValue (pixel[2 * channelStep], holes[j]);
+                       }
+                   }
+               });
+
+  return masked_image;
+}
+
+void ImageMasker::GetHoleRow (const Mat &mask, const int row, uchar *holes)
+{
+  const int channels = mask.channels ();
+
+  if (mask.depth () == CV_32F)
     {
-      for (int j = 0; j < mask.cols; j++)
+      const float *values = mask.ptr<float> (row);
+      for (int j = 0; j < mask.cols; ++j)
         {
-          if (mask.at<float> (i, j) < MASK_THRESHOLD)
-            {
-              masked_image.at<float> (i, j) = static_cast<float>(HOLE_VALUE);
-            }
-          else
-            {
-              masked_image.at<float> (i, j) =
-                  static_cast<float>(gray_image_.at<uchar> (i, j));
-            }
+          holes[j] = (uchar) (values[j * channels] < MASK_THRESHOLD);
         }
+      return;
     }
 
-  return masked_image;
+  const uchar *values = mask.ptr<uchar> (row);
+  if (channels == 1)
+    {
+      for (int j = 0; j < mask.cols; ++j)
+        {
+          holes[j] = (uchar) (values[j] < MASK_THRESHOLD_8U);
+        }
+    }
+  else
+    {
+      for (int j = 0; j < mask.cols; ++j)
+        {
+          holes[j] = (uchar) (GetGrayValue (values + j * channels)
+                              < MASK_THRESHOLD_8U);
+        }
+    }
 }
 
+Rect ImageMasker::GetHoleRoi (const Mat &mask)
+{
+  int minRow = mask.rows;
+  int maxRow = -1;
+  int minCol = mask.cols;
+  int maxCol = -1;
+
+  std::vector<uchar> holes (mask.cols);
+  for (int i = 0; i < mask.rows; ++i)
+    {
+      GetHoleRow (mask, i, holes.data ());
+      std::vector<uchar>::const_iterator first =
+          std::find (holes.begin (), holes.end (), 1);
+      if (first == holes.end ()) continue;
+
+      std::vector<uchar>::const_reverse_iterator last =
+          std::find (holes.rbegin (), holes.rend (), 1);
+      minRow = std::min (minRow, i);
+      maxRow = i;
+      minCol = std::min (minCol, (int) (first - holes.begin ()));
+      maxCol = std::max (maxCol, (int) (holes.rend () - last) - 1);
+    }
+
+  if (maxRow < 0) return Rect ();
+
+  minRow = std::max (minRow - 1, 0);
+  maxRow = std::min (maxRow + 1, mask.rows - 1);
+  minCol = std::max (minCol - 1, 0);
+  maxCol = std::min (maxCol + 1, mask.cols - 1);
+  return Rect (minCol, minRow, maxCol - minCol + 1, maxRow - minRow + 1);
+}
@@ -4,11 +4,27 @@
 #include <opencv2/opencv.hpp>
 
 #define MASK_THRESHOLD 0.5
+// Pixels of 8-bit masks below this value, MASK_THRESHOLD of 255 rounded up,
+// are hole pixels.
+#define MASK_THRESHOLD_8U 128
 #define HOLE_VALUE -1
+
+// The BGR to gray weights 0.114, 0.587 and 0.299 in fixed point, scaled by
+// 2^GRAY_SHIFT, as cvtColor converts 8-bit images.
+#define GRAY_SHIFT 14
+#define GRAY_WEIGHT_B 1868
+#define GRAY_WEIGHT_G 9617
+#define GRAY_WEIGHT_R 4899
 using namespace cv;
 
 /**
  * The ImageMasker class provides a method for masking the hole region in an RGB image.
+ *
+ * Images and masks are walked through their row pointers, a row range per
+ * thread. Every row is converted in a single pass without branches: the
+ * hole pixels of the mask row are found first, and every output value is
+ * then selected arithmetically between the converted pixel and HOLE_VALUE,
+ * which lets the compiler vectorize the loops.
  */
 class ImageMasker {
  public:
@@ -17,15 +33,55 @@ class ImageMasker {
    * This function takes an RGB image and a mask image as inputs and returns a
    * grayscale image after masking. The mask image is used to mark
    * the pixels that belong to the hole region with low values
-   * (i.e., < MASK_THRESHOLD), and these pixels are then
+   * (see GetHoleRow), and these pixels are then
    * replaced with a HOLE_VALUE in the grayscale image.
    *
-   * @param rgb_image The input RGB image.
+   * @param rgb_image The input CV_8UC3 RGB image, or CV_8UC1 gray image.
    * @param mask The input mask image.
+   * @param thread_count The number of threads to use.
    *
    * @return A grayscale image with the masked hole region.
    */
-  static Mat ApplyMask (const Mat &rgb_image, const Mat &mask);
+  static Mat ApplyMask (const Mat &rgb_image, const Mat &mask,
+                        int thread_count = 1);
+
+  /**
+   * This function is the color version of ApplyMask: it returns a CV_32FC3
+   * image with the B, G and R values of the RGB image, where all the channels
+   * of the pixels in the hole region are replaced with a HOLE_VALUE.
+   *
+   * @param rgb_image The input CV_8UC3 RGB image, or CV_8UC1 gray image.
+   * @param mask The input mask image.
+   * @param thread_count The number of threads to use.
+   *
+   * @return A color image with the masked hole region.
+   */
+  static Mat ApplyMaskColor (const Mat &rgb_image, const Mat &mask,
+                             int thread_count = 1);
+
+  /**
+   * Finds the hole pixels of a row of a mask image: the pixels of a CV_8UC1
+   * mask below MASK_THRESHOLD_8U, of a CV_8UC3 mask whose gray value is
+   * below MASK_THRESHOLD_8U, and of a CV_32FC1 mask with values in [0, 1]
+   * below MASK_THRESHOLD.
+   *
+   * @param mask The mask image.
+   * @param row The row of the mask.
+   * @param holes Output for the mask.cols pixels of the row, 1 for hole
+   * pixels and 0 for the others.
+   */
+  static void GetHoleRow (const Mat &mask, int row, uchar *holes);
+
+  /**
+   * Finds the region of interest of a mask: the bounding box of its hole
+   * pixels (see GetHoleRow), grown by the one pixel wide boundary ring of
+   * the holes and clipped to the mask.
+   *
+   * @param mask The mask image.
+   *
+   * @return The region, or an empty Rect if the mask has no hole pixels.
+   */
+  static Rect GetHoleRoi (const Mat &mask);
 };
 
 #endif // IMAGEMASKER_H
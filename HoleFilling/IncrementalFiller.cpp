@@ -0,0 +1,386 @@
+#include "IncrementalFiller.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "ImageMasker.h"
+#include "SpecializedHoleFiller.h"
+
+#define MSG_ERR_INCREMENTAL_TYPE "Error: The image should be a CV_32FC1 or CV_32FC3 image."
+#define MSG_ERR_INCREMENTAL_SIZE "Error: Images have different sizes"
+
+IncrementalFiller::IncrementalFiller (const int z, const double epsilon,
+                                      const int connectivity,
+                                      const int algorithm_type,
+                                      const WeightFunctionType &weight_func,
+                                      const int thread_count)
+    : holeFiller_ (z, epsilon, connectivity, algorithm_type, weight_func,
+                   std::max (thread_count, 1)),
+      connectivity_ (connectivity), channels_ (1), nextLabel_ (NO_HOLE_LABEL),
+      updatedPixelsAmount_ (0)
+{
+}
+
+bool IncrementalFiller::Reset (const Mat &image, const Mat &mask)
+{
+  if (image.empty () || (image.type () != CV_32FC1
+                         && image.type () != CV_32FC3))
+    {
+      std::cerr << MSG_ERR_INCREMENTAL_TYPE << std::endl;
+      return false;
+    }
+  if (mask.rows != image.rows || mask.cols != image.cols)
+    {
+      std::cerr << MSG_ERR_INCREMENTAL_SIZE << std::endl;
+      return false;
+    }
+
+  channels_ = image.channels ();
+  sourceImage_ = image.clone ();
+  filledImage_ = image.clone ();
+  std::vector<uchar> holes (image.cols);
+  for (int i = 0; i < image.rows; ++i)
+    {
+      ImageMasker::GetHoleRow (mask, i, holes.data ());
+      float *values = filledImage_.ptr<float> (i);
+      for (int j = 0; j < image.cols; ++j)
+        {
+          if (!holes[j]) continue;
+
+          std::fill (values + j * channels_, values + (j + 1) * channels_,
+                     (float) HOLE_VALUE);
+        }
+    }
+  holeLabels_ = Mat::zeros (image.rows, image.cols, CV_32SC1);
+  dividendSums_ = Mat::zeros (image.rows, image.cols, CV_64FC (channels_));
+  divisorSums_ = Mat::zeros (image.rows, image.cols, CV_64FC1);
+  nextLabel_ = NO_HOLE_LABEL;
+  labelledHoles_.clear ();
+  updatedPixelsAmount_ = 0;
+
+  holeFiller_.ClearFields ();
+  holeFiller_.channels_ = channels_;
+  holeFiller_.statistics_ = FillStatistics ();
+  holeFiller_.FindHoleAndBoundaryPixels (filledImage_);
+
+  // The search cleared the holes from the mask bitmap. They are set again,
+  // for the searches after the edits.
+  holeFiller_.SetMaskBitmap (filledImage_);
+
+  std::vector<HoleRegion> regions;
+  regions.swap (holeFiller_.holeRegions_);
+  for (HoleRegion &region : regions)
+    {
+      int algorithm = holeFiller_.SelectAlgorithm (region);
+      FillRegion (region, algorithm);
+      LabelHole (region, algorithm);
+      updatedPixelsAmount_ += region.holePixels.size ();
+    }
+
+  return true;
+}
+
+void IncrementalFiller::ApplyMaskDelta (const std::vector<Pixel> &addedPixels,
+                                        const std::vector<Pixel> &removedPixels)
+{
+  updatedPixelsAmount_ = 0;
+  if (filledImage_.empty ()) return;
+
+  PixelBitmap &maskBitmap = holeFiller_.maskBitmap_;
+
+  // The mask is edited first, while the labels keep the holes before the
+  // edit until the edited holes are labelled again.
+  std::vector<Pixel> editedPixels;
+  std::vector<Pixel> clearedPixels;
+  for (const Pixel &pixel : addedPixels)
+    {
+      if (!Contains (pixel) || maskBitmap.Get (pixel.first, pixel.second))
+        continue;
+
+      maskBitmap.Set (pixel.first, pixel.second);
+      float *values = filledImage_.ptr<float> (pixel.first)
+                      + pixel.second * channels_;
+      std::fill (values, values + channels_, (float) HOLE_VALUE);
+      editedPixels.push_back (pixel);
+    }
+  for (const Pixel &pixel : removedPixels)
+    {
+      if (!Contains (pixel) || !maskBitmap.Get (pixel.first, pixel.second))
+        continue;
+
+      maskBitmap.Unset (pixel.first, pixel.second);
+      const float *values = sourceImage_.ptr<float> (pixel.first)
+                            + pixel.second * channels_;
+      std::copy (values, values + channels_,
+                 filledImage_.ptr<float> (pixel.first)
+                 + pixel.second * channels_);
+      editedPixels.push_back (pixel);
+      clearedPixels.push_back (pixel);
+
+      int label = holeLabels_.at<int> (pixel.first, pixel.second);
+      auto labelledHole = labelledHoles_.find (label);
+      if (labelledHole != labelledHoles_.end ()
+          && --labelledHole->second.size == 0)
+        {
+          labelledHoles_.erase (labelledHole);
+        }
+    }
+  if (editedPixels.empty ()) return;
+
+  // Every hole the edit changed holds an edited pixel or a neighbor of one.
+  // The search clears the holes it finds from the mask bitmap, so every
+  // hole is found once.
+  std::vector<HoleRegion> regions;
+  std::vector<int> algorithms;
+  for (const Pixel &editedPixel : editedPixels)
+    {
+      for (int k = -1; k < connectivity_; ++k)
+        {
+          Pixel pixel = editedPixel;
+          if (k >= 0)
+            {
+              pixel.first += NEIGHBOR_OFFSETS_X[k];
+              pixel.second += NEIGHBOR_OFFSETS_Y[k];
+            }
+          if (!maskBitmap.GetChecked (pixel.first, pixel.second)) continue;
+
+          regions.push_back (HoleRegion ());
+          HoleRegion &region = regions.back ();
+          holeFiller_.FindHoleRegion (filledImage_, pixel, region);
+          int algorithm = holeFiller_.SelectAlgorithm (region);
+          algorithms.push_back (algorithm);
+
+          std::unordered_map<int, int> oldLabelSizes;
+          for (const Pixel &holePixel : region.holePixels)
+            {
+              int label = holeLabels_.at<int> (holePixel.first,
+                                               holePixel.second);
+              if (label != NO_HOLE_LABEL) ++oldLabelSizes[label];
+            }
+
+          // A hole with all the pixels of a single hole before the edit keeps
+          // its boundary but around the edit. Merged or split holes do not.
+          auto oldHole = oldLabelSizes.size () == 1
+                         ? labelledHoles_.find (oldLabelSizes.begin ()->first)
+                         : labelledHoles_.end ();
+          if (oldHole != labelledHoles_.end ()
+              && oldHole->second.size == oldLabelSizes.begin ()->second
+              && oldHole->second.algorithm == ALGORITHM_OPTION_ONE
+              && algorithm == ALGORITHM_OPTION_ONE)
+            {
+              UpdateRegion (region, oldHole->first, editedPixels);
+            }
+          else
+            {
+              FillRegion (region, algorithm);
+              updatedPixelsAmount_ += region.holePixels.size ();
+            }
+
+          for (const auto &oldLabelSize : oldLabelSizes)
+            {
+              labelledHoles_.erase (oldLabelSize.first);
+            }
+        }
+    }
+
+  for (const Pixel &pixel : clearedPixels)
+    {
+      holeLabels_.at<int> (pixel.first, pixel.second) = NO_HOLE_LABEL;
+    }
+  for (std::size_t i = 0; i < regions.size (); ++i)
+    {
+      for (const Pixel &pixel : regions[i].holePixels)
+        {
+          maskBitmap.Set (pixel.first, pixel.second);
+        }
+      LabelHole (regions[i], algorithms[i]);
+    }
+}
+
+const Mat &IncrementalFiller::GetFilledImage () const
+{
+  return filledImage_;
+}
+
+std::size_t IncrementalFiller::GetUpdatedPixelsAmount () const
+{
+  return updatedPixelsAmount_;
+}
+
+bool IncrementalFiller::Contains (const Pixel &pixel) const
+{
+  return pixel.first >= 0 && pixel.first < filledImage_.rows
+         && pixel.second >= 0 && pixel.second < filledImage_.cols;
+}
+
+void IncrementalFiller::FillRegion (HoleRegion &region, const int algorithm)
+{
+  if (algorithm == ALGORITHM_OPTION_ONE)
+    {
+      ClearSums (region.holePixels);
+      holeFiller_.AccumulateRegularSums (region.holePixels,
+                                         region.boundaryCoordinates,
+                                         region.boundaryValues, 1,
+                                         dividendSums_, divisorSums_);
+      SetFilledValues (region.holePixels);
+      return;
+    }
+
+  // The other algorithms may start from the hole values.
+  for (const Pixel &pixel : region.holePixels)
+    {
+      float *values = filledImage_.ptr<float> (pixel.first)
+                      + pixel.second * channels_;
+      std::fill (values, values + channels_, (float) HOLE_VALUE);
+    }
+  holeFiller_.FillRegion (filledImage_, region, algorithm);
+}
+
+void IncrementalFiller::UpdateRegion (const HoleRegion &region,
+                                      const int oldLabel,
+                                      const std::vector<Pixel> &editedPixels)
+{
+  std::vector<Pixel> ringPixels;
+  for (const Pixel &editedPixel : editedPixels)
+    {
+      ringPixels.push_back (editedPixel);
+      for (int k = 0; k < connectivity_; ++k)
+        {
+          Pixel neighbor (editedPixel.first + NEIGHBOR_OFFSETS_X[k],
+                          editedPixel.second + NEIGHBOR_OFFSETS_Y[k]);
+          if (Contains (neighbor)) ringPixels.push_back (neighbor);
+        }
+    }
+  std::sort (ringPixels.begin (), ringPixels.end ());
+  ringPixels.erase (std::unique (ringPixels.begin (), ringPixels.end ()),
+                    ringPixels.end ());
+
+  // Both boundaries are in row-major order, as the ring.
+  std::vector<Pixel> oldBoundary;
+  for (const Pixel &pixel : ringPixels)
+    {
+      if (holeLabels_.at<int> (pixel.first, pixel.second) == NO_HOLE_LABEL
+          && WasBoundaryOf (pixel, oldLabel))
+        {
+          oldBoundary.push_back (pixel);
+        }
+    }
+  std::vector<Pixel> newBoundary;
+  std::set_intersection (region.boundaryCoordinates.begin (),
+                         region.boundaryCoordinates.end (),
+                         ringPixels.begin (), ringPixels.end (),
+                         std::back_inserter (newBoundary));
+
+  std::vector<Pixel> addedBoundary;
+  std::vector<Pixel> removedBoundary;
+  std::set_difference (newBoundary.begin (), newBoundary.end (),
+                       oldBoundary.begin (), oldBoundary.end (),
+                       std::back_inserter (addedBoundary));
+  std::set_difference (oldBoundary.begin (), oldBoundary.end (),
+                       newBoundary.begin (), newBoundary.end (),
+                       std::back_inserter (removedBoundary));
+
+  std::vector<Pixel> oldPixels;
+  std::vector<Pixel> newPixels;
+  for (const Pixel &pixel : region.holePixels)
+    {
+      if (holeLabels_.at<int> (pixel.first, pixel.second) == oldLabel)
+        {
+          oldPixels.push_back (pixel);
+        }
+      else
+        {
+          newPixels.push_back (pixel);
+        }
+    }
+
+  holeFiller_.AccumulateRegularSums (oldPixels, addedBoundary,
+                                     GetSourceValues (addedBoundary), 1,
+                                     dividendSums_, divisorSums_);
+  holeFiller_.AccumulateRegularSums (oldPixels, removedBoundary,
+                                     GetSourceValues (removedBoundary), -1,
+                                     dividendSums_, divisorSums_);
+  ClearSums (newPixels);
+  holeFiller_.AccumulateRegularSums (newPixels, region.boundaryCoordinates,
+                                     region.boundaryValues, 1, dividendSums_,
+                                     divisorSums_);
+
+  if (addedBoundary.empty () && removedBoundary.empty ())
+    {
+      SetFilledValues (newPixels);
+      updatedPixelsAmount_ += newPixels.size ();
+    }
+  else
+    {
+      SetFilledValues (region.holePixels);
+      updatedPixelsAmount_ += region.holePixels.size ();
+    }
+}
+
+std::vector<float> IncrementalFiller::GetSourceValues (
+    const std::vector<Pixel> &pixels) const
+{
+  std::vector<float> values;
+  values.reserve (pixels.size () * channels_);
+  for (const Pixel &pixel : pixels)
+    {
+      const float *pixelValues = sourceImage_.ptr<float> (pixel.first)
+                                 + pixel.second * channels_;
+      values.insert (values.end (), pixelValues, pixelValues + channels_);
+    }
+  return values;
+}
+
+void IncrementalFiller::ClearSums (const std::vector<Pixel> &holePixels)
+{
+  for (const Pixel &pixel : holePixels)
+    {
+      double *sums = dividendSums_.ptr<double> (pixel.first)
+                     + pixel.second * channels_;
+      std::fill (sums, sums + channels_, 0.0);
+      divisorSums_.at<double> (pixel.first, pixel.second) = 0;
+    }
+}
+
+void IncrementalFiller::SetFilledValues (const std::vector<Pixel> &holePixels)
+{
+  for (const Pixel &pixel : holePixels)
+    {
+      const double *dividendSums = dividendSums_.ptr<double> (pixel.first)
+                                   + pixel.second * channels_;
+      double divisorSum = divisorSums_.at<double> (pixel.first, pixel.second);
+      float *filledPixel = filledImage_.ptr<float> (pixel.first)
+                           + pixel.second * channels_;
+      for (int c = 0; c < channels_; ++c)
+        {
+          filledPixel[c] = (float) (dividendSums[c] / divisorSum);
+        }
+    }
+}
+
+void IncrementalFiller::LabelHole (const HoleRegion &region,
+                                   const int algorithm)
+{
+  ++nextLabel_;
+  for (const Pixel &pixel : region.holePixels)
+    {
+      holeLabels_.at<int> (pixel.first, pixel.second) = nextLabel_;
+    }
+  labelledHoles_[nextLabel_] =
+      LabelledHole {(int) region.holePixels.size (), algorithm};
+}
+
+bool IncrementalFiller::WasBoundaryOf (const Pixel &pixel,
+                                       const int label) const
+{
+  for (int k = 0; k < connectivity_; ++k)
+    {
+      Pixel neighbor (pixel.first + NEIGHBOR_OFFSETS_X[k],
+                      pixel.second + NEIGHBOR_OFFSETS_Y[k]);
+      if (Contains (neighbor)
+          && holeLabels_.at<int> (neighbor.first, neighbor.second) == label)
+        return true;
+    }
+
+  return false;
+}
@@ -0,0 +1,174 @@
+#ifndef INCREMENTAL_FILLER_H
+#define INCREMENTAL_FILLER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "HoleFiller.h"
+
+#define NO_HOLE_LABEL 0
+
+/**
+ * IncrementalFiller fills the holes of an image with a HoleFiller, and
+ * refills them after edits of the mask, e.g. brush strokes, without
+ * starting over.
+ *
+ * The holes are found and filled by the HoleFiller search and algorithms.
+ * Holes the edit did not reach keep their values. A hole the edit reached is
+ * filled again with the algorithm chosen for it, except for holes of the
+ * regular algorithm. The regular algorithm sums are linear in the boundary:
+ * a hole pixel is the ratio of the sum of its weighted boundary values to the
+ * sum of its weights. The filler keeps both sums of every pixel of these
+ * holes. An edit only changes the boundary around the edited pixels, so the
+ * sums of the hole pixels that were already filled are updated by the
+ * weights of the boundary pixels that were added and removed, and only the
+ * new hole pixels sum their whole boundary. An edit of E boundary pixels to
+ * a hole of H pixels thus costs O(H * E), instead of O(H * B) for a boundary
+ * of B pixels. Holes that merge or split are summed again from scratch, as
+ * their pixels do not share a boundary any more.
+ *
+ * The sums are kept in double precision, from the weights of the regular
+ * algorithm kernels, so the updated values are those of a fill from scratch
+ * up to the rounding of these weights.
+ */
+class IncrementalFiller {
+ public:
+  /**
+   * @brief Constructor for the IncrementalFiller class, with the parameters
+   * of the HoleFiller filling the holes.
+   *
+   * @param z The z of the weight function.
+   * @param epsilon The epsilon of the weight function.
+   * @param connectivity CONNECTIVITY_OPTION_1 or CONNECTIVITY_OPTION_2.
+   * @param algorithm_type The algorithm option, see HoleFiller.
+   * @param weight_func The weight function.
+   * @param thread_count The number of threads the algorithms use.
+   */
+  IncrementalFiller (int z, double epsilon, int connectivity,
+                     int algorithm_type, const WeightFunctionType &weight_func,
+                     int thread_count = 1);
+
+  /**
+   * @brief Fills the holes of an image from scratch, keeping the sums of
+   * the pixels of the regular algorithm holes for the next edits.
+   *
+   * @param image A CV_32FC1 or CV_32FC3 image with the values of all the
+   * pixels, including the hole ones, which are used when the pixels are
+   * removed from the holes. No pixel may have HOLE_VALUE in its first
+   * channel.
+   * @param mask The mask, of the size of the image, read by
+   * ImageMasker::GetHoleRow.
+   *
+   * @return False if the image or the mask is not valid.
+   */
+  bool Reset (const Mat &image, const Mat &mask);
+
+  /**
+   * @brief Edits the mask and refills the holes the edit changed.
+   *
+   * @param addedPixels Pixels to add to the holes. Pixels outside the image
+   * or already in a hole are ignored.
+   * @param removedPixels Pixels to remove from the holes, which get back
+   * their values of the image given to Reset. Pixels outside the image or
+   * outside the holes are ignored.
+   */
+  void ApplyMaskDelta (const std::vector<Pixel> &addedPixels,
+                       const std::vector<Pixel> &removedPixels);
+
+  /**
+   * @brief Returns the filled image, updated by every ApplyMaskDelta call.
+   */
+  const Mat &GetFilledImage () const;
+
+  /**
+   * @brief Returns the number of hole pixels whose value was computed or
+   * updated in the last Reset or ApplyMaskDelta call.
+   */
+  std::size_t GetUpdatedPixelsAmount () const;
+
+ private:
+  /**
+   * @brief A labelled hole: its number of pixels and its algorithm.
+   */
+  struct LabelledHole {
+    int size;
+    int algorithm;
+  };
+
+  // Searches and fills the holes. Its `maskBitmap_` holds the hole pixels
+  // of the edited mask between the calls.
+  HoleFiller holeFiller_;
+  int connectivity_;
+  int channels_;
+
+  Mat sourceImage_;
+  // The filled image, with HOLE_VALUE in the pixels added to the holes
+  // until they are filled.
+  Mat filledImage_;
+  // The label of the hole of every pixel before the edit, NO_HOLE_LABEL
+  // outside the holes.
+  Mat holeLabels_;
+  // The sums of the weighted boundary values of every channel, and of the
+  // weights, of the pixels of the regular algorithm holes.
+  Mat dividendSums_;
+  Mat divisorSums_;
+  int nextLabel_;
+  std::unordered_map<int, LabelledHole> labelledHoles_;
+  std::size_t updatedPixelsAmount_;
+
+  /**
+   * @brief Checks if a pixel is inside the image.
+   */
+  bool Contains (const Pixel &pixel) const;
+
+  /**
+   * @brief Fills all the pixels of a hole: by their sums for the regular
+   * algorithm, otherwise by the HoleFiller.
+   *
+   * @param region The hole, given back its pixels.
+   * @param algorithm The algorithm chosen for the hole.
+   */
+  void FillRegion (HoleRegion &region, int algorithm);
+
+  /**
+   * @brief Refills a regular algorithm hole whose pixels were all in a
+   * single regular algorithm hole before the edit, with all the pixels of
+   * that hole, by the boundary change. Only the edited pixels and their
+   * neighbors may join or leave the boundary.
+   *
+   * @param region The hole.
+   * @param oldLabel The label of the hole before the edit.
+   * @param editedPixels The added and removed pixels.
+   */
+  void UpdateRegion (const HoleRegion &region, int oldLabel,
+                     const std::vector<Pixel> &editedPixels);
+
+  /**
+   * @brief Copies the values of the image given to Reset of boundary pixels,
+   * every channel one after the other.
+   */
+  std::vector<float> GetSourceValues (const std::vector<Pixel> &pixels) const;
+
+  /**
+   * @brief Sets the sums of hole pixels to 0.
+   */
+  void ClearSums (const std::vector<Pixel> &holePixels);
+
+  /**
+   * @brief Sets the values of hole pixels from their sums.
+   */
+  void SetFilledValues (const std::vector<Pixel> &holePixels);
+
+  /**
+   * @brief Gives a new label to the pixels of a hole.
+   */
+  void LabelHole (const HoleRegion &region, int algorithm);
+
+  /**
+   * @brief Checks if a pixel not in a hole before the edit bordered the hole
+   * with a label.
+   */
+  bool WasBoundaryOf (const Pixel &pixel, int label) const;
+};
+
+#endif // INCREMENTAL_FILLER_H
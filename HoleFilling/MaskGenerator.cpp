@@ -0,0 +1,224 @@
+#include "MaskGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+MaskGenerator::MaskGenerator (const unsigned int seed)
+    : random_ (seed)
+{}
+
+Mat MaskGenerator::GenerateMask (const int shape, const int rows,
+                                 const int cols, const double holeFraction)
+{
+  Mat mask (rows, cols, CV_8UC1, Scalar (MASK_VALID_VALUE));
+  int area = std::max ((int) std::lround (holeFraction * rows * cols), 1);
+
+  switch (shape)
+    {
+      case MASK_SHAPE_RECTANGLE:
+        {
+          // Keep a valid pixel around the rectangle for its boundary.
+          double aspect = RandomInt (50, 200) / 100.0;
+          int holeRows = (int) std::lround (std::sqrt (area * aspect));
+          holeRows = std::max (std::min (holeRows, rows - 2), 1);
+          int holeCols = std::min (std::max (area / holeRows, 1), cols - 2);
+          SetRectangle (mask, RandomInt (1, rows - holeRows - 1),
+                        RandomInt (1, cols - holeCols - 1), holeRows,
+                        holeCols);
+        }
+      break;
+
+      case MASK_SHAPE_BLOB:
+        SetBlob (mask, area);
+      break;
+
+      case MASK_SHAPE_SCRATCHES:
+        SetScratches (mask, area);
+      break;
+
+      case MASK_SHAPE_SMALL_HOLES:
+        SetSmallHoles (mask, area);
+      break;
+
+      case MASK_SHAPE_BORDER:
+        SetBorderHoles (mask, area);
+      break;
+    }
+
+  return mask;
+}
+
+Mat MaskGenerator::GenerateImage (const int rows, const int cols)
+{
+  Mat image (rows, cols, CV_8UC3);
+  for (int x = 0; x < rows; ++x)
+    {
+      uchar *pixels = image.ptr<uchar> (x);
+      for (int y = 0; y < cols; ++y)
+        {
+          for (int c = 0; c < 3; ++c)
+            {
+              double value = 128 + RandomInt (-8, 8)
+                             + 90 * std::sin (0.013 * x * (c + 1) + 0.021 * y);
+              pixels[y * 3 + c] = (uchar) std::min (std::max (value, 0.0),
+                                                    255.0);
+            }
+        }
+    }
+
+  return image;
+}
+
+const char *MaskGenerator::GetShapeName (const int shape)
+{
+  switch (shape)
+    {
+      case MASK_SHAPE_RECTANGLE:
+        return "rectangle";
+
+      case MASK_SHAPE_BLOB:
+        return "blob";
+
+      case MASK_SHAPE_SCRATCHES:
+        return "scratches";
+
+      case MASK_SHAPE_SMALL_HOLES:
+        return "small-holes";
+
+      case MASK_SHAPE_BORDER:
+        return "border";
+    }
+
+  return "unknown";
+}
+
+int MaskGenerator::CountHolePixels (const Mat &mask)
+{
+  int holePixels = 0;
+  for (int x = 0; x < mask.rows; ++x)
+    {
+      const uchar *values = mask.ptr<uchar> (x);
+      holePixels += (int) std::count (values, values + mask.cols,
+                                      (uchar) MASK_HOLE_VALUE);
+    }
+
+  return holePixels;
+}
+
+int MaskGenerator::RandomInt (const int min, const int max)
+{
+  if (max <= min) return min;
+
+  return min + (int) (random_ () % (unsigned int) (max - min + 1));
+}
+
+int MaskGenerator::SetRectangle (Mat &mask, const int firstRow,
+                                 const int firstCol, const int rows,
+                                 const int cols)
+{
+  int setPixels = 0;
+  int lastRow = std::min (firstRow + rows, mask.rows);
+  int lastCol = std::min (firstCol + cols, mask.cols);
+  for (int x = std::max (firstRow, 0); x < lastRow; ++x)
+    {
+      uchar *values = mask.ptr<uchar> (x);
+      for (int y = std::max (firstCol, 0); y < lastCol; ++y)
+        {
+          setPixels += (values[y] != MASK_HOLE_VALUE);
+          values[y] = MASK_HOLE_VALUE;
+        }
+    }
+
+  return setPixels;
+}
+
+void MaskGenerator::SetBlob (Mat &mask, const int area)
+{
+  double maxRadius = (std::min (mask.rows, mask.cols) - 4)
+                     / (2 * (1 + BLOB_RADIUS_VARIATION));
+  // The radius of a disc of the area, as the lobes add little to it.
+  double radius = std::min (std::sqrt (area / CV_PI), maxRadius);
+  int reach = (int) std::ceil (radius * (1 + BLOB_RADIUS_VARIATION));
+  int centerX = RandomInt (reach + 1, mask.rows - reach - 2);
+  int centerY = RandomInt (reach + 1, mask.cols - reach - 2);
+  double phase = RandomInt (0, 628) / 100.0;
+
+  for (int x = centerX - reach; x <= centerX + reach; ++x)
+    {
+      uchar *values = mask.ptr<uchar> (x);
+      for (int y = centerY - reach; y <= centerY + reach; ++y)
+        {
+          double angle = std::atan2 ((double) (x - centerX),
+                                     (double) (y - centerY));
+          double edge = radius * (1 + BLOB_RADIUS_VARIATION
+                                      * std::sin (BLOB_LOBES_AMOUNT * angle
+                                                  + phase));
+          if (std::hypot (x - centerX, y - centerY) <= edge)
+            {
+              values[y] = MASK_HOLE_VALUE;
+            }
+        }
+    }
+}
+
+void MaskGenerator::SetScratches (Mat &mask, const int area)
+{
+  int minLength = std::max (std::min (mask.rows, mask.cols) / 4, 2);
+  int maxLength = std::max (std::min (mask.rows, mask.cols) / 2, 2);
+  int setPixels = 0;
+  while (setPixels < area)
+    {
+      int length = RandomInt (minLength, maxLength);
+      double angle = RandomInt (0, 314) / 100.0;
+      double stepX = std::sin (angle);
+      double stepY = std::cos (angle);
+
+      // Both ends lie inside the mask, away from its border.
+      int reachX = (int) std::ceil (std::fabs (stepX) * length)
+                   + SCRATCH_WIDTH;
+      int reachY = (int) std::ceil (std::fabs (stepY) * length)
+                   + SCRATCH_WIDTH;
+      int firstX = RandomInt (1, std::max (mask.rows - reachX - 1, 1));
+      int firstY = RandomInt (1, std::max (mask.cols - reachY - 1, 1));
+      if (stepX < 0) firstX += reachX - SCRATCH_WIDTH;
+      if (stepY < 0) firstY += reachY - SCRATCH_WIDTH;
+
+      for (int i = 0; i <= length && setPixels < area; ++i)
+        {
+          int x = firstX + (int) std::lround (stepX * i);
+          int y = firstY + (int) std::lround (stepY * i);
+          setPixels += SetRectangle (mask, x, y,
+                                     std::min (SCRATCH_WIDTH,
+                                               mask.rows - 1 - x),
+                                     std::min (SCRATCH_WIDTH,
+                                               mask.cols - 1 - y));
+        }
+    }
+}
+
+void MaskGenerator::SetSmallHoles (Mat &mask, const int area)
+{
+  int setPixels = 0;
+  while (setPixels < area)
+    {
+      setPixels += SetRectangle (
+          mask, RandomInt (1, mask.rows - SMALL_HOLE_SIZE - 1),
+          RandomInt (1, mask.cols - SMALL_HOLE_SIZE - 1), SMALL_HOLE_SIZE,
+          SMALL_HOLE_SIZE);
+    }
+}
+
+void MaskGenerator::SetBorderHoles (Mat &mask, const int area)
+{
+  int size = (int) std::lround (std::sqrt ((double) area
+                                          / BORDER_HOLES_AMOUNT));
+  size = std::max (std::min (size, std::min (mask.rows, mask.cols) / 2), 1);
+
+  // One hole on every side, the first one in a corner.
+  SetRectangle (mask, 0, 0, size, size);
+  SetRectangle (mask, mask.rows - size, RandomInt (0, mask.cols - size), size,
+                size);
+  SetRectangle (mask, RandomInt (0, mask.rows - size), 0, size, size);
+  SetRectangle (mask, RandomInt (0, mask.rows - size), mask.cols - size, size,
+                size);
+}
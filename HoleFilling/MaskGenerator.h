@@ -0,0 +1,100 @@
+#ifndef MASK_GENERATOR_H
+#define MASK_GENERATOR_H
+
+#include <opencv2/core.hpp>
+
+#include <random>
+
+#define MASK_SHAPE_RECTANGLE 0
+#define MASK_SHAPE_BLOB 1
+#define MASK_SHAPE_SCRATCHES 2
+#define MASK_SHAPE_SMALL_HOLES 3
+#define MASK_SHAPE_BORDER 4
+#define MASK_SHAPES_AMOUNT 5
+
+#define MASK_HOLE_VALUE 0
+#define MASK_VALID_VALUE 255
+#define BLOB_RADIUS_VARIATION 0.3
+#define BLOB_LOBES_AMOUNT 3
+#define SCRATCH_WIDTH 2
+#define SMALL_HOLE_SIZE 3
+#define BORDER_HOLES_AMOUNT 4
+
+using namespace cv;
+
+/**
+ * MaskGenerator makes synthetic images and masks to fill, for benchmarks.
+ * The output only depends on the seed and on the arguments, so every run
+ * measures the same holes. Masks are CV_8UC1, with MASK_HOLE_VALUE for
+ * hole pixels and MASK_VALID_VALUE for the others, as read by
+ * ImageMasker::ApplyMask.
+ */
+class MaskGenerator {
+ public:
+  /**
+   * @brief Constructor for the MaskGenerator class.
+   *
+   * @param seed The seed of the random numbers.
+   */
+  explicit MaskGenerator (unsigned int seed);
+
+  /**
+   * @brief Makes a mask with holes of a shape.
+   *
+   * MASK_SHAPE_RECTANGLE is a single rectangle, MASK_SHAPE_BLOB a single
+   * disc with a wavy edge, MASK_SHAPE_SCRATCHES thin lines of SCRATCH_WIDTH
+   * pixels, MASK_SHAPE_SMALL_HOLES many squares of SMALL_HOLE_SIZE pixels
+   * and MASK_SHAPE_BORDER BORDER_HOLES_AMOUNT squares touching the sides of
+   * the image. Only the holes of MASK_SHAPE_BORDER touch the border.
+   *
+   * @param shape One of the MASK_SHAPE options.
+   * @param rows The number of rows of the mask.
+   * @param cols The number of columns of the mask.
+   * @param holeFraction The part of the mask area to cover with holes. The
+   * holes cover about this area, as the shapes are made of whole pixels.
+   *
+   * @return The mask.
+   */
+  Mat GenerateMask (int shape, int rows, int cols, double holeFraction);
+
+  /**
+   * @brief Makes a smooth CV_8UC3 image with a little noise.
+   */
+  Mat GenerateImage (int rows, int cols);
+
+  /**
+   * @brief Returns the name of a MASK_SHAPE option.
+   */
+  static const char *GetShapeName (int shape);
+
+  /**
+   * @brief Returns the number of hole pixels of a mask.
+   */
+  static int CountHolePixels (const Mat &mask);
+
+ private:
+  std::mt19937 random_;
+
+  /**
+   * @brief Returns a random integer in [min, max].
+   */
+  int RandomInt (int min, int max);
+
+  /**
+   * @brief Marks a rectangle of the mask as a hole, clipped to the mask.
+   *
+   * @return The number of pixels that were not hole pixels before.
+   */
+  static int SetRectangle (Mat &mask, int firstRow, int firstCol, int rows,
+                           int cols);
+
+  void SetBlob (Mat &mask, int area);
+
+  void SetScratches (Mat &mask, int area);
+
+  void SetSmallHoles (Mat &mask, int area);
+
+  void SetBorderHoles (Mat &mask, int area);
+};
+
+#endif // MASK_GENERATOR_H
@@ -0,0 +1,335 @@
+#include "MultigridSolver.h"
+
+#include <algorithm>
+
+namespace {
+
+// The neighbors in the order of HoleFiller::GetNeighborPixel, the first four
+// are on the axes.
+const int NEIGHBOR_OFFSETS_X[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+const int NEIGHBOR_OFFSETS_Y[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+/**
+ * @brief Returns the index of the neighbor at the given offsets.
+ */
+int GetDirection (const int offsetX, const int offsetY)
+{
+  for (int i = 0; i < 8; ++i)
+    {
+      if (NEIGHBOR_OFFSETS_X[i] == offsetX && NEIGHBOR_OFFSETS_Y[i] == offsetY)
+        return i;
+    }
+  return 0;
+}
+
+}
+
+MultigridSolver::MultigridSolver (const int connectivity,
+                                  const double axisWeight,
+                                  const double diagonalWeight)
+    : neighborsAmount_ (connectivity == 8 ? 8 : 4)
+{
+  for (int i = 0; i < 8; ++i)
+    {
+      neighborWeights_[i] = (i < 4) ? axisWeight : diagonalWeight;
+    }
+}
+
+void MultigridSolver::Solve (const std::vector<Pixel> &holePixels,
+                             const std::vector<Pixel> &boundaryCoordinates,
+                             const std::vector<float> &boundaryValues,
+                             const int minX, const int minY, const int rows,
+                             const int cols,
+                             std::vector<float> &holeValues) const
+{
+  std::vector<Level> levels (1);
+  InitLevel (levels[0], rows, cols);
+  Level &fine = levels[0];
+
+  // The boundary values stay in the finest grid as the known cells.
+  double boundaryMean = 0;
+  for (std::size_t i = 0; i < boundaryCoordinates.size (); ++i)
+    {
+      std::size_t cell =
+          (std::size_t) (boundaryCoordinates[i].first - minX + 1) * fine.stride
+          + (boundaryCoordinates[i].second - minY + 1);
+      fine.values[cell] = boundaryValues[i];
+      boundaryMean += boundaryValues[i];
+    }
+  if (!boundaryCoordinates.empty ())
+    {
+      boundaryMean /= boundaryCoordinates.size ();
+    }
+
+  for (const Pixel &holePixel : holePixels)
+    {
+      std::size_t cell =
+          (std::size_t) (holePixel.first - minX + 1) * fine.stride
+          + (holePixel.second - minY + 1);
+      fine.unknown[cell] = 1;
+      fine.values[cell] = boundaryMean;
+    }
+  ComputeDivisors (fine);
+
+  while (std::max (levels.back ().rows, levels.back ().cols)
+         > MULTIGRID_COARSEST_SIZE)
+    {
+      levels.push_back (Level ());
+      Coarsen (levels[levels.size () - 2], levels.back ());
+    }
+
+  for (int i = 0; i < MULTIGRID_V_CYCLES_AMOUNT; ++i)
+    {
+      VCycle (levels, 0);
+    }
+
+  holeValues.resize (holePixels.size ());
+  for (std::size_t i = 0; i < holePixels.size (); ++i)
+    {
+      std::size_t cell =
+          (std::size_t) (holePixels[i].first - minX + 1) * levels[0].stride
+          + (holePixels[i].second - minY + 1);
+      holeValues[i] = (float) levels[0].values[cell];
+    }
+}
+
+void MultigridSolver::InitLevel (Level &level, const int rows,
+                                 const int cols) const
+{
+  level.rows = rows;
+  level.cols = cols;
+  level.stride = cols + 2;
+
+  std::size_t size = (std::size_t) (rows + 2) * level.stride;
+  level.unknown.assign (size, 0);
+  level.divisor.assign (size, 0);
+  level.values.assign (size, 0);
+  level.rhs.assign (size, 0);
+  level.residual.assign (size, 0);
+  level.correction.assign (size, 0);
+}
+
+void MultigridSolver::GetNeighborOffsets (const Level &level,
+                                          long offsets[8]) const
+{
+  for (int i = 0; i < 8; ++i)
+    {
+      offsets[i] = (long) NEIGHBOR_OFFSETS_X[i] * level.stride
+                   + NEIGHBOR_OFFSETS_Y[i];
+    }
+}
+
+void MultigridSolver::ComputeDivisors (Level &level) const
+{
+  for (int x = 1; x <= level.rows; ++x)
+    {
+      for (int y = 1; y <= level.cols; ++y)
+        {
+          std::size_t cell = (std::size_t) x * level.stride + y;
+          if (!level.unknown[cell]) continue;
+
+          double divisor = 0;
+          for (int i = 0; i < neighborsAmount_; ++i)
+            {
+              int neighborX = x + NEIGHBOR_OFFSETS_X[i];
+              int neighborY = y + NEIGHBOR_OFFSETS_Y[i];
+              if (neighborX >= 1 && neighborX <= level.rows
+                  && neighborY >= 1 && neighborY <= level.cols)
+                {
+                  divisor += neighborWeights_[i];
+                }
+            }
+          level.divisor[cell] = divisor;
+        }
+    }
+}
+
+const double *MultigridSolver::GetWeights (const Level &level,
+                                           const std::size_t cell) const
+{
+  return level.weights.empty () ? neighborWeights_ : &level.weights[cell * 8];
+}
+
+void MultigridSolver::Coarsen (const Level &fine, Level &coarse) const
+{
+  InitLevel (coarse, (fine.rows + 1) / 2, (fine.cols + 1) / 2);
+  coarse.weights.assign (coarse.values.size () * 8, 0);
+
+  long offsets[8];
+  GetNeighborOffsets (fine, offsets);
+
+  // A coarse cell couples to a neighboring one through the couplings of
+  // their children, and couplings between children of the same cell cancel
+  // out of its equation.
+  for (int x = 1; x <= fine.rows; ++x)
+    {
+      for (int y = 1; y <= fine.cols; ++y)
+        {
+          std::size_t cell = (std::size_t) x * fine.stride + y;
+          if (!fine.unknown[cell]) continue;
+
+          int parentX = (x + 1) / 2;
+          int parentY = (y + 1) / 2;
+          std::size_t parent = (std::size_t) parentX * coarse.stride + parentY;
+          coarse.unknown[parent] = 1;
+          coarse.divisor[parent] += fine.divisor[cell];
+
+          const double *cellWeights = GetWeights (fine, cell);
+          for (int i = 0; i < neighborsAmount_; ++i)
+            {
+              if (!fine.unknown[cell + offsets[i]]) continue;
+
+              int neighborParentX = (x + NEIGHBOR_OFFSETS_X[i] + 1) / 2;
+              int neighborParentY = (y + NEIGHBOR_OFFSETS_Y[i] + 1) / 2;
+              if (neighborParentX == parentX && neighborParentY == parentY)
+                {
+                  coarse.divisor[parent] -= cellWeights[i];
+                }
+              else
+                {
+                  int direction = GetDirection (neighborParentX - parentX,
+                                                neighborParentY - parentY);
+                  coarse.weights[parent * 8 + direction] += cellWeights[i];
+                }
+            }
+        }
+    }
+}
+
+void MultigridSolver::Smooth (Level &level, const int sweeps) const
+{
+  long offsets[8];
+  GetNeighborOffsets (level, offsets);
+
+  for (int sweep = 0; sweep < sweeps; ++sweep)
+    {
+      for (int x = 1; x <= level.rows; ++x)
+        {
+          for (int y = 1; y <= level.cols; ++y)
+            {
+              std::size_t cell = (std::size_t) x * level.stride + y;
+              if (!level.unknown[cell]) continue;
+
+              // Padding cells hold 0, so they add nothing to the sum.
+              const double *cellWeights = GetWeights (level, cell);
+              double dividendSum = level.rhs[cell];
+              for (int i = 0; i < neighborsAmount_; ++i)
+                {
+                  dividendSum += cellWeights[i]
+                                 * level.values[cell + offsets[i]];
+                }
+              level.values[cell] = dividendSum / level.divisor[cell];
+            }
+        }
+    }
+}
+
+void MultigridSolver::ComputeResidual (Level &level) const
+{
+  long offsets[8];
+  GetNeighborOffsets (level, offsets);
+
+  for (int x = 1; x <= level.rows; ++x)
+    {
+      for (int y = 1; y <= level.cols; ++y)
+        {
+          std::size_t cell = (std::size_t) x * level.stride + y;
+          if (!level.unknown[cell]) continue;
+
+          const double *cellWeights = GetWeights (level, cell);
+          double residual = level.rhs[cell]
+                            - level.divisor[cell] * level.values[cell];
+          for (int i = 0; i < neighborsAmount_; ++i)
+            {
+              residual += cellWeights[i] * level.values[cell + offsets[i]];
+            }
+          level.residual[cell] = residual;
+        }
+    }
+}
+
+void MultigridSolver::VCycle (std::vector<Level> &levels,
+                              const std::size_t index) const
+{
+  Level &fine = levels[index];
+  if (index + 1 == levels.size ())
+    {
+      Smooth (fine, MULTIGRID_COARSEST_SWEEPS);
+      return;
+    }
+
+  Smooth (fine, MULTIGRID_PRE_SMOOTHING_SWEEPS);
+  ComputeResidual (fine);
+
+  // The coarse grid solves for the error of the fine one, which is 0 on the
+  // known cells, with the sums of the residuals of the children.
+  Level &coarse = levels[index + 1];
+  std::fill (coarse.values.begin (), coarse.values.end (), 0.0);
+  std::fill (coarse.rhs.begin (), coarse.rhs.end (), 0.0);
+  for (int x = 1; x <= fine.rows; ++x)
+    {
+      for (int y = 1; y <= fine.cols; ++y)
+        {
+          std::size_t cell = (std::size_t) x * fine.stride + y;
+          if (!fine.unknown[cell]) continue;
+
+          coarse.rhs[(std::size_t) ((x + 1) / 2) * coarse.stride
+                     + ((y + 1) / 2)] += fine.residual[cell];
+        }
+    }
+
+  VCycle (levels, index + 1);
+
+  // Every child gets the correction of its parent. A piecewise constant
+  // correction is too small for smooth errors, so it is scaled by the step
+  // along it that minimizes the error energy, (r . c) / (c . A c).
+  for (int x = 1; x <= fine.rows; ++x)
+    {
+      for (int y = 1; y <= fine.cols; ++y)
+        {
+          std::size_t cell = (std::size_t) x * fine.stride + y;
+          if (!fine.unknown[cell]) continue;
+
+          fine.correction[cell] = coarse.values[(std::size_t) ((x + 1) / 2)
+                                                * coarse.stride
+                                                + ((y + 1) / 2)];
+        }
+    }
+
+  long offsets[8];
+  GetNeighborOffsets (fine, offsets);
+
+  double residualProduct = 0;
+  double energy = 0;
+  for (int x = 1; x <= fine.rows; ++x)
+    {
+      for (int y = 1; y <= fine.cols; ++y)
+        {
+          std::size_t cell = (std::size_t) x * fine.stride + y;
+          if (!fine.unknown[cell]) continue;
+
+          const double *cellWeights = GetWeights (fine, cell);
+          double product = fine.divisor[cell] * fine.correction[cell];
+          for (int i = 0; i < neighborsAmount_; ++i)
+            {
+              product -= cellWeights[i] * fine.correction[cell + offsets[i]];
+            }
+          residualProduct += fine.residual[cell] * fine.correction[cell];
+          energy += fine.correction[cell] * product;
+        }
+    }
+
+  double step = (energy > 0) ? (residualProduct / energy) : 0;
+  for (int x = 1; x <= fine.rows; ++x)
+    {
+      for (int y = 1; y <= fine.cols; ++y)
+        {
+          std::size_t cell = (std::size_t) x * fine.stride + y;
+          if (!fine.unknown[cell]) continue;
+
+          fine.values[cell] += step * fine.correction[cell];
+        }
+    }
+
+  Smooth (fine, MULTIGRID_POST_SMOOTHING_SWEEPS);
+}
@@ -0,0 +1,138 @@
+#ifndef MULTIGRID_SOLVER_H
+#define MULTIGRID_SOLVER_H
+
+#include <vector>
+
+#include "WeightFunction.h"
+
+#define MULTIGRID_V_CYCLES_AMOUNT 20
+#define MULTIGRID_PRE_SMOOTHING_SWEEPS 2
+#define MULTIGRID_POST_SMOOTHING_SWEEPS 2
+// Grids of at most this many cells on each axis are not coarsened further,
+// and are solved with MULTIGRID_COARSEST_SWEEPS sweeps instead.
+#define MULTIGRID_COARSEST_SIZE 4
+#define MULTIGRID_COARSEST_SWEEPS 50
+
+/**
+ * MultigridSolver fills a hole by solving the neighbor averaging system: every
+ * hole pixel is the weighted average of its neighbors, where the weight of a
+ * neighbor only depends on whether it is on an axis or on a diagonal.
+ *
+ * Gauss-Seidel sweeps over the hole, like the approximate algorithm, only
+ * remove the error that changes from pixel to pixel quickly. The solver runs
+ * V-cycles instead: after a few sweeps, the remaining error is solved for on
+ * a grid with half the resolution, recursively, added back and smoothed by a
+ * few more sweeps. A V-cycle costs O(N) for N pixels in the bounds of the
+ * hole, and a fixed number of them is enough whatever the width of the hole.
+ *
+ * A coarse cell stands for its four children: the residual of the children
+ * is summed into it, its correction is added to all of them, and its
+ * equation is the sum of theirs (the Galerkin coarse operator). So the
+ * boundary and the image border shape the coarse grids exactly like they
+ * shape the hole, however few pixels wide it is.
+ */
+class MultigridSolver {
+ public:
+  /**
+   * @brief Constructs a solver for the given connectivity and weights.
+   *
+   * @param connectivity 4 or 8.
+   * @param axisWeight The weight of a neighbor on an axis.
+   * @param diagonalWeight The weight of a neighbor on a diagonal, not used
+   * with 4-connectivity.
+   */
+  MultigridSolver (int connectivity, double axisWeight, double diagonalWeight);
+
+  /**
+   * @brief Solves for the values of the pixels of a hole.
+   *
+   * The hole and its boundary must lie inside the given bounds, and every
+   * neighbor of a hole pixel inside the bounds must be a hole or a boundary
+   * pixel. Neighbors outside the bounds are ignored.
+   *
+   * @param holePixels The coordinates of the hole pixels.
+   * @param boundaryCoordinates The coordinates of the boundary pixels.
+   * @param boundaryValues The values of the boundary pixels.
+   * @param minX The smallest x coordinate of the bounds.
+   * @param minY The smallest y coordinate of the bounds.
+   * @param rows The amount of x coordinates of the bounds.
+   * @param cols The amount of y coordinates of the bounds.
+   * @param holeValues Output for the values of the hole pixels, in the
+   * order of holePixels.
+   */
+  void Solve (const std::vector<Pixel> &holePixels,
+              const std::vector<Pixel> &boundaryCoordinates,
+              const std::vector<float> &boundaryValues, int minX, int minY,
+              int rows, int cols, std::vector<float> &holeValues) const;
+
+ private:
+  /**
+   * @brief A grid of the multigrid hierarchy, with a ring of padding cells
+   * around it that always hold 0.
+   */
+  struct Level {
+    int rows;
+    int cols;
+    int stride;
+    std::vector<unsigned char> unknown;
+    // The coefficient of a cell in its own equation.
+    std::vector<double> divisor;
+    // The weights of the 8 neighbors of every cell, empty in the finest grid
+    // whose weights are `neighborWeights_`.
+    std::vector<double> weights;
+    std::vector<double> values;
+    std::vector<double> rhs;
+    std::vector<double> residual;
+    // The correction from the coarser grid, 0 on the known cells.
+    std::vector<double> correction;
+  };
+
+  int neighborsAmount_;
+  double neighborWeights_[8];
+
+  /**
+   * @brief Sizes a level, with all its cells known and holding 0.
+   */
+  void InitLevel (Level &level, int rows, int cols) const;
+
+  /**
+   * @brief Computes the divisors of the unknown cells of the finest grid,
+   * the sums of the weights of their neighbors inside it.
+   */
+  void ComputeDivisors (Level &level) const;
+
+  /**
+   * @brief Returns the weights of the neighbors of a cell.
+   */
+  const double *GetWeights (const Level &level, std::size_t cell) const;
+
+  /**
+   * @brief Computes the offsets of the neighbors of a cell in the arrays of
+   * a level.
+   */
+  void GetNeighborOffsets (const Level &level, long offsets[8]) const;
+
+  /**
+   * @brief Builds the next coarser level, whose cells are unknown when any
+   * of their four children is, and whose equations are the sums of those of
+   * their children.
+   */
+  void Coarsen (const Level &fine, Level &coarse) const;
+
+  /**
+   * @brief Runs Gauss-Seidel sweeps over the unknown cells of a level.
+   */
+  void Smooth (Level &level, int sweeps) const;
+
+  /**
+   * @brief Computes the residual of the unknown cells of a level.
+   */
+  void ComputeResidual (Level &level) const;
+
+  /**
+   * @brief Runs a V-cycle from the given level down to the coarsest one.
+   */
+  void VCycle (std::vector<Level> &levels, std::size_t index) const;
+};
+
+#endif // MULTIGRID_SOLVER_H
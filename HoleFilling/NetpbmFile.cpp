@@ -0,0 +1,141 @@
+#include "NetpbmFile.h"
+
+#include <cctype>
+#include <utility>
+
+NetpbmReader::NetpbmReader ()
+    : dataOffset_ (0), rows_ (0), cols_ (0), channels_ (0)
+{}
+
+bool NetpbmReader::Open (const std::string &path)
+{
+  file_.open (path, std::ios::binary);
+  if (!file_) return false;
+
+  char magic[3] = {};
+  file_.read (magic, 2);
+  if (std::string (magic) == NETPBM_GRAY_MAGIC)
+    {
+      channels_ = 1;
+    }
+  else if (std::string (magic) == NETPBM_COLOR_MAGIC)
+    {
+      channels_ = 3;
+    }
+  else
+    {
+      return false;
+    }
+
+  int maxValue;
+  if (!ReadHeaderNumber (cols_) || !ReadHeaderNumber (rows_)
+      || !ReadHeaderNumber (maxValue))
+    return false;
+  if (cols_ <= 0 || rows_ <= 0 || maxValue <= 0 || maxValue > NETPBM_MAX_VALUE)
+    return false;
+
+  // A single white space character separates the header from the samples.
+  file_.get ();
+  dataOffset_ = file_.tellg ();
+  return (bool) file_;
+}
+
+int NetpbmReader::Rows () const
+{
+  return rows_;
+}
+
+int NetpbmReader::Cols () const
+{
+  return cols_;
+}
+
+int NetpbmReader::Channels () const
+{
+  return channels_;
+}
+
+bool NetpbmReader::Read (const int firstRow, const int firstCol,
+                         const int rows, const int cols, Mat &pixels)
+{
+  pixels.create (rows, cols, CV_MAKETYPE (CV_8U, channels_));
+  for (int i = 0; i < rows; ++i)
+    {
+      std::streamoff offset =
+          dataOffset_
+          + ((std::streamoff) (firstRow + i) * cols_ + firstCol) * channels_;
+      file_.seekg (offset);
+      uchar *row = pixels.ptr<uchar> (i);
+      file_.read ((char *) row, (std::streamsize) cols * channels_);
+
+      if (channels_ == 3)
+        {
+          for (int j = 0; j < cols; ++j)
+            {
+              std::swap (row[j * 3], row[j * 3 + 2]);
+            }
+        }
+    }
+
+  return (bool) file_;
+}
+
+bool NetpbmReader::ReadHeaderNumber (int &number)
+{
+  int character = file_.get ();
+  while (character != EOF
+         && (std::isspace (character) || character == NETPBM_COMMENT))
+    {
+      if (character == NETPBM_COMMENT)
+        {
+          while (character != EOF && character != '\n')
+            {
+              character = file_.get ();
+            }
+        }
+      character = file_.get ();
+    }
+  if (character == EOF) return false;
+
+  file_.unget ();
+  file_ >> number;
+  return (bool) file_;
+}
+
+bool NetpbmWriter::Open (const std::string &path, const int rows,
+                         const int cols, const int channels)
+{
+  file_.open (path, std::ios::binary);
+  if (!file_) return false;
+
+  cols_ = cols;
+  channels_ = channels;
+  rowBuffer_.resize ((std::size_t) cols * channels);
+  file_ << (channels == 3 ? NETPBM_COLOR_MAGIC : NETPBM_GRAY_MAGIC) << "\n"
+        << cols << " " << rows << "\n" << NETPBM_MAX_VALUE << "\n";
+  return (bool) file_;
+}
+
+bool NetpbmWriter::WriteRow (const uchar *row)
+{
+  const uchar *samples = row;
+  if (channels_ == 3)
+    {
+      for (int j = 0; j < cols_; ++j)
+        {
+          rowBuffer_[j * 3] = row[j * 3 + 2];
+          rowBuffer_[j * 3 + 1] = row[j * 3 + 1];
+          rowBuffer_[j * 3 + 2] = row[j * 3];
+        }
+      samples = rowBuffer_.data ();
+    }
+
+  file_.write ((const char *) samples, (std::streamsize) cols_ * channels_);
+  return (bool) file_;
+}
+
+bool NetpbmWriter::Close ()
+{
+  file_.close ();
+  return !file_.fail ();
+}
@@ -0,0 +1,112 @@
+#ifndef NETPBM_FILE_H
+#define NETPBM_FILE_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#define NETPBM_GRAY_MAGIC "P5"
+#define NETPBM_COLOR_MAGIC "P6"
+#define NETPBM_MAX_VALUE 255
+#define NETPBM_COMMENT '#'
+
+using namespace cv;
+
+/**
+ * NetpbmReader reads rectangles of a binary PGM (P5) or PPM (P6) file with
+ * 8-bit samples, seeking to their rows instead of decoding the whole image.
+ * PPM pixels are returned in the BGR order of imread.
+ */
+class NetpbmReader {
+ public:
+  NetpbmReader ();
+
+  /**
+   * @brief Opens a file and reads its header.
+   *
+   * @return False if the file could not be opened or is not a binary PGM or
+   * PPM file with 8-bit samples.
+   */
+  bool Open (const std::string &path);
+
+  /**
+   * @brief Returns the number of rows of the image.
+   */
+  int Rows () const;
+
+  /**
+   * @brief Returns the number of columns of the image.
+   */
+  int Cols () const;
+
+  /**
+   * @brief Returns the number of channels of the image, 1 or 3.
+   */
+  int Channels () const;
+
+  /**
+   * @brief Reads a rectangle of the image.
+   *
+   * @param firstRow The first row of the rectangle.
+   * @param firstCol The first column of the rectangle.
+   * @param rows The number of rows of the rectangle.
+   * @param cols The number of columns of the rectangle.
+   * @param pixels Output CV_8UC1 or CV_8UC3 matrix of the rectangle.
+   *
+   * @return False if the file could not be read.
+   */
+  bool Read (int firstRow, int firstCol, int rows, int cols, Mat &pixels);
+
+ private:
+  std::ifstream file_;
+  std::streamoff dataOffset_;
+  int rows_;
+  int cols_;
+  int channels_;
+
+  /**
+   * @brief Reads a number of the header, skipping the white space and the
+   * comments before it.
+   */
+  bool ReadHeaderNumber (int &number);
+};
+
+/**
+ * NetpbmWriter writes a binary PGM (P5) or PPM (P6) file row by row, so the
+ * image never has to be in memory as a whole. PPM pixels are given in the
+ * BGR order of imwrite.
+ */
+class NetpbmWriter {
+ public:
+  /**
+   * @brief Creates a file and writes its header.
+   *
+   * @param channels 1 for a PGM file, 3 for a PPM file.
+   *
+   * @return False if the file could not be created.
+   */
+  bool Open (const std::string &path, int rows, int cols, int channels);
+
+  /**
+   * @brief Writes the next row of the image.
+   *
+   * @param row The cols * channels samples of the row.
+   */
+  bool WriteRow (const uchar *row);
+
+  /**
+   * @brief Flushes and closes the file.
+   *
+   * @return False if any write failed.
+   */
+  bool Close ();
+
+ private:
+  std::ofstream file_;
+  int cols_;
+  int channels_;
+  std::vector<uchar> rowBuffer_;
+};
+
+#endif // NETPBM_FILE_H
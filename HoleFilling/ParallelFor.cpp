@@ -0,0 +1,75 @@
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#define CHUNKS_PER_THREAD 16
+
+void ParallelFor (const std::size_t count, const int threadCount,
+                  const RangeFunctionType &rangeFunction)
+{
+  if (count == 0) return;
+
+  std::size_t workersAmount = std::min<std::size_t> (
+      std::max (threadCount, 1), count);
+  if (workersAmount == 1)
+    {
+      rangeFunction (0, count);
+      return;
+    }
+
+  std::size_t chunkSize = std::max<std::size_t> (
+      1, count / (workersAmount * CHUNKS_PER_THREAD));
+  std::atomic<std::size_t> nextChunkBegin (0);
+  // An exception may not leave a thread, so every worker keeps its own.
+  std::vector<std::exception_ptr> exceptions (workersAmount);
+
+  auto worker = [&] (std::size_t workerIndex)
+  {
+    try
+      {
+        while (true)
+          {
+            std::size_t begin = nextChunkBegin.fetch_add (chunkSize);
+            if (begin >= count) return;
+
+            rangeFunction (begin, std::min (begin + chunkSize, count));
+          }
+      }
+    catch (...)
+      {
+        exceptions[workerIndex] = std::current_exception ();
+        nextChunkBegin = count;
+      }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < workersAmount; ++i)
+    {
+      // The running workers claim the chunks of the threads that could not
+      // be started.
+      try
+        {
+          threads.emplace_back (worker, i);
+        }
+      catch (const std::system_error &)
+        {
+          break;
+        }
+    }
+  worker (0);
+
+  for (std::thread &thread : threads)
+    {
+      thread.join ();
+    }
+
+  for (const std::exception_ptr &exception : exceptions)
+    {
+      if (exception) std::rethrow_exception (exception);
+    }
+}
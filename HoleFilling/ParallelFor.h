@@ -0,0 +1,33 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Alias for a function processing the index range [begin, end).
+ */
+typedef std::function<void (std::size_t, std::size_t)> RangeFunctionType;
+
+/**
+ * @brief Runs a function over the index range [0, count) using several
+ * threads.
+ *
+ * The range is cut into chunks that the threads claim one after the other,
+ * so threads that get cheap chunks keep working instead of waiting for the
+ * others. Different chunks never overlap, so the function may write to
+ * per-index outputs without locking.
+ *
+ * An exception thrown by the function stops the claiming of new chunks. All
+ * the threads are joined, then the first exception is rethrown on the
+ * calling thread.
+ *
+ * @param count The number of indices to process.
+ * @param threadCount The number of threads to use (the calling thread
+ * included). Values smaller than 2 run the whole range on the calling thread.
+ * @param rangeFunction The function called for every chunk.
+ */
+void ParallelFor (std::size_t count, int threadCount,
+                  const RangeFunctionType &rangeFunction);
+
+#endif // PARALLEL_FOR_H
@@ -0,0 +1,60 @@
+#include "PixelBitmap.h"
+
+PixelBitmap::PixelBitmap ()
+    : rows_ (0), cols_ (0), wordsPerRow_ (0)
+{}
+
+PixelBitmap::PixelBitmap (const int rows, const int cols)
+    : PixelBitmap ()
+{
+  Reset (rows, cols);
+}
+
+void PixelBitmap::Reset (const int rows, const int cols)
+{
+  rows_ = rows;
+  cols_ = cols;
+  wordsPerRow_ = (cols + 63) / 64;
+  words_.assign ((std::size_t) rows * wordsPerRow_, 0);
+}
+
+void PixelBitmap::Clear ()
+{
+  rows_ = 0;
+  cols_ = 0;
+  wordsPerRow_ = 0;
+  std::vector<uint64_t> ().swap (words_);
+}
+
+uint64_t PixelBitmap::GetBoundaryWord (const int x, const int word,
+                                       const bool diagonal) const
+{
+  uint64_t bits = RowWords (x)[word];
+  uint64_t dilated = GetRowDilatedWord (x, word);
+
+  for (int neighborX = x - 1; neighborX <= x + 1; neighborX += 2)
+    {
+      if (neighborX < 0 || neighborX >= rows_) continue;
+
+      dilated |= diagonal ? GetRowDilatedWord (neighborX, word)
+                          : RowWords (neighborX)[word];
+    }
+
+  // Growing the last word of a row may set the bits past the last column.
+  int lastBits = cols_ - word * 64;
+  uint64_t columns = (lastBits >= 64) ? ~uint64_t (0)
+                                      : (uint64_t (1) << lastBits) - 1;
+  return dilated & ~bits & columns;
+}
+
+uint64_t PixelBitmap::GetRowDilatedWord (const int x, const int word) const
+{
+  const uint64_t *row = RowWords (x);
+  uint64_t bits = row[word];
+  uint64_t previous = (word > 0) ? row[word - 1] : 0;
+  uint64_t next = (word + 1 < wordsPerRow_) ? row[word + 1] : 0;
+
+  // Bit b is column word * 64 + b, so a shift to the higher bits moves the
+  // pixels one column to the right.
+  return bits | (bits << 1) | (previous >> 63) | (bits >> 1) | (next << 63);
+}
@@ -0,0 +1,119 @@
+#ifndef PIXEL_BITMAP_H
+#define PIXEL_BITMAP_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * PixelBitmap stores one bit per pixel of an image, e.g. whether the pixel
+ * was visited or belongs to a hole. Pixels are addressed like
+ * Mat::at (x, y) and every row starts at a new 64 bit word, so the words
+ * of a row can also be read and written directly, 64 pixels at a time:
+ * bit b of word w of a row is the pixel of column w * 64 + b.
+ */
+class PixelBitmap {
+ public:
+  PixelBitmap ();
+
+  /**
+   * @brief Constructs a bitmap of the given size with all bits cleared.
+   */
+  PixelBitmap (int rows, int cols);
+
+  /**
+   * @brief Resizes the bitmap and clears all the bits.
+   */
+  void Reset (int rows, int cols);
+
+  /**
+   * @brief Releases the memory of the bitmap.
+   */
+  void Clear ();
+
+  bool Get (const int x, const int y) const
+  {
+    return ((words_[WordIndex (x, y)] >> (y & 63)) & 1) != 0;
+  }
+
+  void Set (const int x, const int y)
+  {
+    words_[WordIndex (x, y)] |= (uint64_t (1) << (y & 63));
+  }
+
+  void Unset (const int x, const int y)
+  {
+    words_[WordIndex (x, y)] &= ~(uint64_t (1) << (y & 63));
+  }
+
+  /**
+   * @brief Checks if a pixel is inside the bitmap and its bit is set.
+   */
+  bool GetChecked (const int x, const int y) const
+  {
+    return x >= 0 && x < rows_ && y >= 0 && y < cols_ && Get (x, y);
+  }
+
+  int Rows () const
+  { return rows_; }
+
+  int Cols () const
+  { return cols_; }
+
+  int WordsPerRow () const
+  { return wordsPerRow_; }
+
+  uint64_t *RowWords (const int x)
+  { return words_.data () + (std::size_t) x * wordsPerRow_; }
+
+  const uint64_t *RowWords (const int x) const
+  { return words_.data () + (std::size_t) x * wordsPerRow_; }
+
+  /**
+   * @brief Returns a word of the boundary of the set pixels: the pixels
+   * whose bit is not set, with a 4-connected neighbor whose bit is set, or
+   * with an 8-connected one when diagonal is true. The word is the
+   * dilation of the set pixels by a 3x3 cross or square, without them,
+   * computed for its 64 pixels at once.
+   *
+   * @param x The row of the word.
+   * @param word The index of the word in the row.
+   * @param diagonal Include the diagonal neighbors (8-connectivity).
+   */
+  uint64_t GetBoundaryWord (int x, int word, bool diagonal) const;
+
+  /**
+   * @brief Returns the index of the lowest set bit of a non zero word.
+   */
+  static int LowestBit (const uint64_t word)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll (word);
+#else
+    int bit = 0;
+    while (((word >> bit) & 1) == 0)
+      {
+        bit++;
+      }
+    return bit;
+#endif
+  }
+
+ private:
+  int rows_;
+  int cols_;
+  int wordsPerRow_;
+  std::vector<uint64_t> words_;
+
+  int WordIndex (const int x, const int y) const
+  {
+    return (x * wordsPerRow_) + (y >> 6);
+  }
+
+  /**
+   * @brief Returns a word of a row with its set pixels grown by one column
+   * to the left and to the right, across the neighbor words.
+   */
+  uint64_t GetRowDilatedWord (int x, int word) const;
+};
+
+#endif // PIXEL_BITMAP_H
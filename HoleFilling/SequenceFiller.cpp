@@ -0,0 +1,108 @@
+#include "SequenceFiller.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "ImageMasker.h"
+
+SequenceFiller::SequenceFiller (HoleFiller &hole_filler, const bool color,
+                                const int thread_count)
+    : holeFiller_ (hole_filler), color_ (color), threadCount_ (thread_count),
+      planReused_ (false)
+{}
+
+Mat SequenceFiller::FillFrame (const Mat &frame, const Mat &mask)
+{
+  Mat maskedFrame =
+      color_ ? ImageMasker::ApplyMaskColor (frame, mask, threadCount_)
+             : ImageMasker::ApplyMask (frame, mask, threadCount_);
+
+  planReused_ = IsSameMask (mask, previousMask_);
+  if (!planReused_)
+    {
+      plan_ = holeFiller_.CreatePlan (maskedFrame);
+      previousMask_ = mask.clone ();
+    }
+
+  // A frame of another size has another mask, and starts from HOLE_VALUE.
+  Mat initialImage;
+  if (previousFilledFrame_.size () == maskedFrame.size ()
+      && previousFilledFrame_.type () == maskedFrame.type ())
+    {
+      initialImage = previousFilledFrame_;
+    }
+
+  previousFilledFrame_ = holeFiller_.FillImage (maskedFrame, plan_,
+                                                initialImage);
+  return previousFilledFrame_;
+}
+
+bool SequenceFiller::IsPlanReused () const
+{
+  return planReused_;
+}
+
+bool SequenceFiller::IsFramePattern (const std::string &pattern)
+{
+  std::size_t begin;
+  int width;
+  return FindConversion (pattern, begin, width) > 0;
+}
+
+std::string SequenceFiller::FormatFramePath (const std::string &pattern,
+                                             const int frameNumber)
+{
+  std::size_t begin;
+  int width;
+  std::size_t length = FindConversion (pattern, begin, width);
+  if (length == 0) return pattern;
+
+  std::string number = std::to_string (frameNumber);
+  if ((int) number.size () < width)
+    {
+      number.insert (0, width - number.size (), '0');
+    }
+
+  return pattern.substr (0, begin) + number + pattern.substr (begin + length);
+}
+
+bool SequenceFiller::IsSameMask (const Mat &mask, const Mat &otherMask)
+{
+  if (mask.size () != otherMask.size () || mask.type () != otherMask.type ())
+    return false;
+
+  std::size_t rowSize = mask.cols * mask.elemSize ();
+  for (int i = 0; i < mask.rows; ++i)
+    {
+      if (std::memcmp (mask.ptr (i), otherMask.ptr (i), rowSize) != 0)
+        return false;
+    }
+
+  return true;
+}
+
+std::size_t SequenceFiller::FindConversion (const std::string &pattern,
+                                            std::size_t &begin, int &width)
+{
+  for (begin = pattern.find (FRAME_PATTERN_CONVERSION);
+       begin != std::string::npos;
+       begin = pattern.find (FRAME_PATTERN_CONVERSION, begin + 1))
+    {
+      std::size_t end = begin + 1;
+      while (end < pattern.size ()
+             && std::isdigit ((unsigned char) pattern[end]))
+        {
+          end++;
+        }
+
+      if (end < pattern.size () && pattern[end] == FRAME_PATTERN_INTEGER)
+        {
+          width = std::atoi (pattern.substr (begin + 1, end - begin - 1)
+                                 .c_str ());
+          return end - begin + 1;
+        }
+    }
+
+  return 0;
+}
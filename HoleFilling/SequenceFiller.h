@@ -0,0 +1,91 @@
+#ifndef SEQUENCE_FILLER_H
+#define SEQUENCE_FILLER_H
+
+#include <string>
+
+#include "HoleFiller.h"
+
+// The residual tolerance of the approximate algorithm in sequence mode when
+// none is given: without one the sweeps never stop early.
+#define SEQUENCE_RESIDUAL_TOLERANCE 0.05
+#define FRAME_PATTERN_CONVERSION '%'
+#define FRAME_PATTERN_INTEGER 'd'
+
+/**
+ * SequenceFiller fills the frames of a video one after the other with a
+ * HoleFiller. The hole pixels of the approximate algorithm start from the
+ * filled previous frame instead of HOLE_VALUE, so when consecutive frames
+ * are alike the sweeps stop after the few needed to absorb the new boundary
+ * values, see HoleFiller::FillImage (image, plan, initialImage). The
+ * FillPlan of the holes is made for the mask of the first frame, and made
+ * again only when the mask changes.
+ */
+class SequenceFiller {
+ public:
+  /**
+   * @brief Constructor for the SequenceFiller class.
+   *
+   * @param hole_filler The HoleFiller filling the frames.
+   * @param color Fill the frames in color, see ImageMasker::ApplyMaskColor.
+   * @param thread_count The number of threads masking the frames.
+   */
+  SequenceFiller (HoleFiller &hole_filler, bool color, int thread_count = 1);
+
+  /**
+   * @brief Fills the next frame of the sequence.
+   *
+   * @param frame The frame, as read by imread.
+   * @param mask The mask of the frame, of its size.
+   *
+   * @return The filled frame. It is kept as the initial image of the next
+   * frame, so it must not be changed.
+   */
+  Mat FillFrame (const Mat &frame, const Mat &mask);
+
+  /**
+   * @brief Checks if the last FillFrame call reused the plan of the previous
+   * frame, its mask being the same.
+   */
+  bool IsPlanReused () const;
+
+  /**
+   * @brief Checks if a path pattern has a frame number conversion, `%d` or
+   * `%0Nd`.
+   */
+  static bool IsFramePattern (const std::string &pattern);
+
+  /**
+   * @brief Returns a path pattern with its frame number conversion replaced
+   * by a frame number, e.g. `frame%04d.png` and 7 give `frame0007.png`.
+   */
+  static std::string FormatFramePath (const std::string &pattern,
+                                      int frameNumber);
+
+ private:
+  HoleFiller &holeFiller_;
+  bool color_;
+  int threadCount_;
+  bool planReused_;
+  FillPlan plan_;
+  Mat previousMask_;
+  Mat previousFilledFrame_;
+
+  /**
+   * @brief Checks if two masks have the same size, type and values.
+   */
+  static bool IsSameMask (const Mat &mask, const Mat &otherMask);
+
+  /**
+   * @brief Finds the frame number conversion of a path pattern.
+   *
+   * @param pattern The path pattern.
+   * @param begin Output for the index of the conversion.
+   * @param width Output for the zero padded width of the number.
+   *
+   * @return The length of the conversion, 0 if there is none.
+   */
+  static std::size_t FindConversion (const std::string &pattern,
+                                     std::size_t &begin, int &width);
+};
+
+#endif // SEQUENCE_FILLER_H
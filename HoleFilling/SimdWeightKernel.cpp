@@ -0,0 +1,304 @@
+#include "SimdWeightKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_WEIGHT_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// Widest supported vector, the arrays are padded to a multiple of it.
+#define SIMD_MAX_LANES 16
+
+// Lanes accumulate in float over blocks of this many boundary pixels, and
+// every block is then added to the double sums to bound the round off.
+#define SIMD_BLOCK_SIZE 1024
+
+// Higher powers overflow float for distances that fit in an image.
+#define SIMD_MAX_POWER 8
+
+namespace {
+
+typedef void (*KernelFunctionType) (const BoundarySoA &, float, float, int,
+                                    float, double &, double &);
+
+/**
+ * @brief Scalar version of the kernel, used when no SIMD instruction set is
+ * available.
+ */
+void AccumulateScalar (const BoundarySoA &boundary, const float holeX,
+                       const float holeY, const int z, const float epsilon,
+                       double &dividendSum, double &divisorSum)
+{
+  for (std::size_t i = 0; i < boundary.size; ++i)
+    {
+      double dx = boundary.x[i] - holeX;
+      double dy = boundary.y[i] - holeY;
+      double distance = std::sqrt ((dx * dx) + (dy * dy));
+      double weight = 1.0 / (std::pow (distance, z) + epsilon);
+
+      dividendSum += (boundary.values[i] * weight);
+      divisorSum += weight;
+    }
+}
+
+#ifdef SIMD_WEIGHT_KERNEL_X86
+
+__attribute__((target("sse2"))) inline __m128
+PowSse (__m128 base, int exponent)
+{
+  __m128 result = _mm_set1_ps (1.0f);
+  while (exponent > 0)
+    {
+      if (exponent & 1) result = _mm_mul_ps (result, base);
+      base = _mm_mul_ps (base, base);
+      exponent >>= 1;
+    }
+  return result;
+}
+
+__attribute__((target("sse2"))) void
+AccumulateSse (const BoundarySoA &boundary, const float holeX,
+               const float holeY, const int z, const float epsilon,
+               double &dividendSum, double &divisorSum)
+{
+  const __m128 holeXs = _mm_set1_ps (holeX);
+  const __m128 holeYs = _mm_set1_ps (holeY);
+  const __m128 epsilons = _mm_set1_ps (epsilon);
+  const __m128 ones = _mm_set1_ps (1.0f);
+  const bool isOddPower = (z % 2) != 0;
+  const int exponent = isOddPower ? z : z / 2;
+  const std::size_t count = boundary.x.size ();
+
+  float lanes[4];
+  for (std::size_t block = 0; block < count; block += SIMD_BLOCK_SIZE)
+    {
+      __m128 dividends = _mm_setzero_ps ();
+      __m128 divisors = _mm_setzero_ps ();
+      std::size_t blockEnd = std::min (count, block + SIMD_BLOCK_SIZE);
+
+      for (std::size_t i = block; i < blockEnd; i += 4)
+        {
+          __m128 dx = _mm_sub_ps (_mm_loadu_ps (&boundary.x[i]), holeXs);
+          __m128 dy = _mm_sub_ps (_mm_loadu_ps (&boundary.y[i]), holeYs);
+          __m128 squaredDistance = _mm_add_ps (_mm_mul_ps (dx, dx),
+                                               _mm_mul_ps (dy, dy));
+          __m128 base = isOddPower ? _mm_sqrt_ps (squaredDistance)
+                                   : squaredDistance;
+          __m128 weights = _mm_div_ps (
+              ones, _mm_add_ps (PowSse (base, exponent), epsilons));
+
+          dividends = _mm_add_ps (
+              dividends, _mm_mul_ps (weights,
+                                     _mm_loadu_ps (&boundary.values[i])));
+          divisors = _mm_add_ps (divisors, weights);
+        }
+
+      _mm_storeu_ps (lanes, dividends);
+      dividendSum += (double) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+      _mm_storeu_ps (lanes, divisors);
+      divisorSum += (double) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+}
+
+__attribute__((target("avx2"))) inline __m256
+PowAvx2 (__m256 base, int exponent)
+{
+  __m256 result = _mm256_set1_ps (1.0f);
+  while (exponent > 0)
+    {
+      if (exponent & 1) result = _mm256_mul_ps (result, base);
+      base = _mm256_mul_ps (base, base);
+      exponent >>= 1;
+    }
+  return result;
+}
+
+__attribute__((target("avx2"))) double
+HorizontalSumAvx2 (__m256 lanes)
+{
+  float values[8];
+  _mm256_storeu_ps (values, lanes);
+  double sum = 0;
+  for (float value : values)
+    {
+      sum += value;
+    }
+  return sum;
+}
+
+__attribute__((target("avx2"))) void
+AccumulateAvx2 (const BoundarySoA &boundary, const float holeX,
+                const float holeY, const int z, const float epsilon,
+                double &dividendSum, double &divisorSum)
+{
+  const __m256 holeXs = _mm256_set1_ps (holeX);
+  const __m256 holeYs = _mm256_set1_ps (holeY);
+  const __m256 epsilons = _mm256_set1_ps (epsilon);
+  const __m256 ones = _mm256_set1_ps (1.0f);
+  const bool isOddPower = (z % 2) != 0;
+  const int exponent = isOddPower ? z : z / 2;
+  const std::size_t count = boundary.x.size ();
+
+  for (std::size_t block = 0; block < count; block += SIMD_BLOCK_SIZE)
+    {
+      __m256 dividends = _mm256_setzero_ps ();
+      __m256 divisors = _mm256_setzero_ps ();
+      std::size_t blockEnd = std::min (count, block + SIMD_BLOCK_SIZE);
+
+      for (std::size_t i = block; i < blockEnd; i += 8)
+        {
+          __m256 dx = _mm256_sub_ps (_mm256_loadu_ps (&boundary.x[i]),
+                                     holeXs);
+          __m256 dy = _mm256_sub_ps (_mm256_loadu_ps (&boundary.y[i]),
+                                     holeYs);
+          __m256 squaredDistance = _mm256_add_ps (_mm256_mul_ps (dx, dx),
+                                                  _mm256_mul_ps (dy, dy));
+          __m256 base = isOddPower ? _mm256_sqrt_ps (squaredDistance)
+                                   : squaredDistance;
+          __m256 weights = _mm256_div_ps (
+              ones, _mm256_add_ps (PowAvx2 (base, exponent), epsilons));
+
+          dividends = _mm256_add_ps (
+              dividends,
+              _mm256_mul_ps (weights, _mm256_loadu_ps (&boundary.values[i])));
+          divisors = _mm256_add_ps (divisors, weights);
+        }
+
+      dividendSum += HorizontalSumAvx2 (dividends);
+      divisorSum += HorizontalSumAvx2 (divisors);
+    }
+}
+
+__attribute__((target("avx512f"))) inline __m512
+PowAvx512 (__m512 base, int exponent)
+{
+  __m512 result = _mm512_set1_ps (1.0f);
+  while (exponent > 0)
+    {
+      if (exponent & 1) result = _mm512_mul_ps (result, base);
+      base = _mm512_mul_ps (base, base);
+      exponent >>= 1;
+    }
+  return result;
+}
+
+__attribute__((target("avx512f"))) void
+AccumulateAvx512 (const BoundarySoA &boundary, const float holeX,
+                  const float holeY, const int z, const float epsilon,
+                  double &dividendSum, double &divisorSum)
+{
+  const __m512 holeXs = _mm512_set1_ps (holeX);
+  const __m512 holeYs = _mm512_set1_ps (holeY);
+  const __m512 epsilons = _mm512_set1_ps (epsilon);
+  const __m512 ones = _mm512_set1_ps (1.0f);
+  const bool isOddPower = (z % 2) != 0;
+  const int exponent = isOddPower ? z : z / 2;
+  const std::size_t count = boundary.x.size ();
+
+  for (std::size_t block = 0; block < count; block += SIMD_BLOCK_SIZE)
+    {
+      __m512 dividends = _mm512_setzero_ps ();
+      __m512 divisors = _mm512_setzero_ps ();
+      std::size_t blockEnd = std::min (count, block + SIMD_BLOCK_SIZE);
+
+      for (std::size_t i = block; i < blockEnd; i += 16)
+        {
+          __m512 dx = _mm512_sub_ps (_mm512_loadu_ps (&boundary.x[i]),
+                                     holeXs);
+          __m512 dy = _mm512_sub_ps (_mm512_loadu_ps (&boundary.y[i]),
+                                     holeYs);
+          __m512 squaredDistance = _mm512_add_ps (_mm512_mul_ps (dx, dx),
+                                                  _mm512_mul_ps (dy, dy));
+          __m512 base = isOddPower ? _mm512_sqrt_ps (squaredDistance)
+                                   : squaredDistance;
+          __m512 weights = _mm512_div_ps (
+              ones, _mm512_add_ps (PowAvx512 (base, exponent), epsilons));
+
+          dividends = _mm512_add_ps (
+              dividends,
+              _mm512_mul_ps (weights, _mm512_loadu_ps (&boundary.values[i])));
+          divisors = _mm512_add_ps (divisors, weights);
+        }
+
+      dividendSum += _mm512_reduce_add_ps (dividends);
+      divisorSum += _mm512_reduce_add_ps (divisors);
+    }
+}
+
+#endif // SIMD_WEIGHT_KERNEL_X86
+
+/**
+ * @brief Picks the widest kernel the running CPU supports.
+ */
+KernelFunctionType SelectKernel ()
+{
+#ifdef SIMD_WEIGHT_KERNEL_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512f")) return &AccumulateAvx512;
+  if (__builtin_cpu_supports ("avx2")) return &AccumulateAvx2;
+  if (__builtin_cpu_supports ("sse2")) return &AccumulateSse;
+#endif
+  return &AccumulateScalar;
+}
+
+/**
+ * @brief Returns the kernel picked for the running CPU.
+ */
+KernelFunctionType GetKernel ()
+{
+  static const KernelFunctionType kernel = SelectKernel ();
+  return kernel;
+}
+
+}
+
+void BoundarySoA::Assign (const std::vector<Pixel> &coordinates,
+                          const std::vector<float> &pixelValues)
+{
+  size = coordinates.size ();
+  std::size_t paddedSize =
+      ((size + SIMD_MAX_LANES - 1) / SIMD_MAX_LANES) * SIMD_MAX_LANES;
+
+  // Padding pixels are so far away that their weight is 0.
+  x.assign (paddedSize, std::numeric_limits<float>::max ());
+  y.assign (paddedSize, std::numeric_limits<float>::max ());
+  values.assign (paddedSize, 0.0f);
+
+  for (std::size_t i = 0; i < size; ++i)
+    {
+      x[i] = (float) coordinates[i].first;
+      y[i] = (float) coordinates[i].second;
+      values[i] = pixelValues[i];
+    }
+}
+
+void BoundarySoA::Clear ()
+{
+  size = 0;
+  x.clear ();
+  y.clear ();
+  values.clear ();
+}
+
+bool SimdWeightKernel::SupportsPower (const int z)
+{
+  return z > 0 && z <= SIMD_MAX_POWER;
+}
+
+bool SimdWeightKernel::IsVectorized ()
+{
+  return GetKernel () != &AccumulateScalar;
+}
+
+void SimdWeightKernel::Accumulate (const BoundarySoA &boundary,
+                                   const Pixel &holePixel, const int z,
+                                   const double epsilon, double &dividendSum,
+                                   double &divisorSum)
+{
+  GetKernel () (boundary, (float) holePixel.first, (float) holePixel.second, z,
+          (float) epsilon, dividendSum, divisorSum);
+}
@@ -0,0 +1,82 @@
+#ifndef SIMD_WEIGHT_KERNEL_H
+#define SIMD_WEIGHT_KERNEL_H
+
+#include <cstddef>
+#include <vector>
+
+#include "WeightFunction.h"
+
+/**
+ * @brief Structure-of-arrays storage of the boundary pixels.
+ *
+ * Keeping the x coordinates, y coordinates and values in separate contiguous
+ * arrays lets the SIMD kernel load several boundary pixels with a single
+ * instruction. The arrays are padded with pixels that are infinitely far
+ * away, so the kernel never needs a scalar tail loop.
+ */
+struct BoundarySoA {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> values;
+
+  /**
+   * @brief Number of real (non padding) boundary pixels.
+   */
+  std::size_t size = 0;
+
+  /**
+   * @brief Replaces the content with the given boundary pixels.
+   *
+   * @param coordinates The coordinates of the boundary pixels.
+   * @param pixelValues The values of the boundary pixels.
+   */
+  void Assign (const std::vector<Pixel> &coordinates,
+               const std::vector<float> &pixelValues);
+
+  /**
+   * @brief Removes all the boundary pixels.
+   */
+  void Clear ();
+};
+
+/**
+ * The SimdWeightKernel class accumulates the regular algorithm sums of a hole
+ * pixel for the distance-power weight of MyWeightFunction,
+ * 1 / (|p1 - p2|^z + epsilon), evaluating 16 (AVX-512), 8 (AVX2) or 4 (SSE)
+ * boundary pixels per instruction. The widest instruction set supported by
+ * the running CPU is picked once, with a scalar fallback for other CPUs and
+ * compilers.
+ */
+class SimdWeightKernel {
+ public:
+  /**
+   * @brief Checks if the kernel can evaluate the weight for a given z. Other
+   * values of z have to use MyWeightFunction directly.
+   *
+   * @param z The power to which the Euclidean distance is raised.
+   */
+  static bool SupportsPower (int z);
+
+  /**
+   * @brief Checks if the running CPU has one of the SIMD instruction sets,
+   * rather than using the scalar fallback.
+   */
+  static bool IsVectorized ();
+
+  /**
+   * @brief Adds the weighted boundary values and the weights of all the
+   * boundary pixels for a single hole pixel.
+   *
+   * @param boundary The boundary pixels.
+   * @param holePixel The coordinates of the hole pixel.
+   * @param z The power to which the Euclidean distance is raised.
+   * @param epsilon The epsilon added to the distance power.
+   * @param dividendSum A reference to the sum of the weighted values.
+   * @param divisorSum A reference to the sum of the weights.
+   */
+  static void Accumulate (const BoundarySoA &boundary, const Pixel &holePixel,
+                          int z, double epsilon, double &dividendSum,
+                          double &divisorSum);
+};
+
+#endif // SIMD_WEIGHT_KERNEL_H
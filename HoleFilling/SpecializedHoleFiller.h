@@ -0,0 +1,442 @@
+#ifndef SPECIALIZED_HOLE_FILLER_H
+#define SPECIALIZED_HOLE_FILLER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "HoleFiller.h"
+
+/**
+ * @brief Offsets of the neighbors of a pixel, in the order used by
+ * HoleFiller::GetNeighborPixel. The first four are the 4-connectivity
+ * neighbors.
+ */
+constexpr int NEIGHBOR_OFFSETS_X[CONNECTIVITY_OPTION_2] =
+    {1, -1, 0, 0, 1, 1, -1, -1};
+constexpr int NEIGHBOR_OFFSETS_Y[CONNECTIVITY_OPTION_2] =
+    {0, 0, 1, -1, 1, -1, 1, -1};
+
+/**
+ * @brief Computes base^Exponent with Exponent - 1 multiplications.
+ */
+template <int Exponent>
+struct IntegerPower {
+  static constexpr double Of (const double base)
+  {
+    return base * IntegerPower<Exponent - 1>::Of (base);
+  }
+};
+
+template <>
+struct IntegerPower<0> {
+  static constexpr double Of (const double)
+  {
+    return 1.0;
+  }
+};
+
+/**
+ * @brief The MyWeightFunction weight, 1 / (|p1 - p2|^Z + epsilon), with z
+ * known at compile time.
+ *
+ * The distance power is computed from the squared distance by
+ * multiplications: for even z, |p1 - p2|^z = (dx^2 + dy^2)^(z / 2) and no
+ * square root is needed at all.
+ */
+template <int Z>
+struct DistancePowerWeight {
+  static double GetWeight (const Pixel &p1, const Pixel &p2,
+                           const double epsilon)
+  {
+    double dx = p2.first - p1.first;
+    double dy = p2.second - p1.second;
+    double squaredDistance = (dx * dx) + (dy * dy);
+    double distancePower = IntegerPower<Z / 2>::Of (squaredDistance);
+    if (Z % 2 != 0)
+      {
+        distancePower *= std::sqrt (squaredDistance);
+      }
+    return (1.0 / (distancePower + epsilon));
+  }
+};
+
+/**
+ * @brief Calls a function for the neighbors Index, ..., Count - 1 of a pixel.
+ * The recursion is resolved at compile time, so the loop is fully unrolled.
+ */
+template <int Index, int Count>
+struct NeighborLoop {
+  template <typename Function>
+  static void Run (const Pixel &pixel, Function &function)
+  {
+    function (Pixel (pixel.first + NEIGHBOR_OFFSETS_X[Index],
+                     pixel.second + NEIGHBOR_OFFSETS_Y[Index]));
+    NeighborLoop<Index + 1, Count>::Run (pixel, function);
+  }
+};
+
+template <int Count>
+struct NeighborLoop<Count, Count> {
+  template <typename Function>
+  static void Run (const Pixel &, Function &)
+  {}
+};
+
+/**
+ * Neighborhood implements the neighbor loops of the HoleFiller algorithms for
+ * a connectivity known at compile time, so they are unrolled instead of
+ * checking the connectivity for every neighbor.
+ *
+ * @tparam Connectivity CONNECTIVITY_OPTION_1 or CONNECTIVITY_OPTION_2.
+ */
+template <int Connectivity>
+class Neighborhood {
+ public:
+  /**
+   * @brief Calls a function for every neighbor of a pixel.
+   */
+  template <typename Function>
+  static void ForEachNeighbor (const Pixel &pixel, Function function)
+  {
+    NeighborLoop<0, Connectivity>::Run (pixel, function);
+  }
+
+  /**
+   * @brief Sets the layers of the hole pixels, see HoleFiller::SetLayers.
+   *
+   * The layers are found by a breadth first search from the boundary, which
+   * walks the pixels of the previous layer in the layers array itself.
+   *
+   * @param holePixels The coordinates of the hole pixels.
+   * @param boundaryCoordinates The coordinates of the boundary pixels.
+   * @param bounds The bounds of the hole and of its boundary.
+   * @param layers Output layers of the hole pixels.
+   */
+  static void SetLayers (const std::vector<Pixel> &holePixels,
+                         const std::vector<Pixel> &boundaryCoordinates,
+                         const PixelBounds &bounds, HoleLayers &layers)
+  {
+    layers.Reset (bounds.minX, bounds.minY, bounds.maxX, bounds.maxY);
+    for (const Pixel &holePixel : holePixels)
+      {
+        layers.Set (holePixel.first, holePixel.second, UNSET_LAYER);
+      }
+
+    int curLayer = 0;
+
+    auto setLayer = [&] (const Pixel &pixel)
+    {
+      if (!layers.Contains (pixel.first, pixel.second)) return;
+      if (layers.Get (pixel.first, pixel.second) != UNSET_LAYER) return;
+
+      layers.Set (pixel.first, pixel.second, curLayer + 1);
+      layers.AddPixel (pixel);
+    };
+
+    for (const Pixel &pixel : boundaryCoordinates)
+      {
+        ForEachNeighbor (pixel, setLayer);
+      }
+
+    while (layers.EndLayer ())
+      {
+        curLayer += 1;
+        for (std::size_t i = layers.LayerBegin (curLayer);
+             i < layers.LayerEnd (curLayer); ++i)
+          {
+            // Copied, as adding pixels may move the layers array.
+            Pixel pixel = layers.Pixels ()[i];
+            ForEachNeighbor (pixel, setLayer);
+          }
+      }
+  }
+};
+
+/**
+ * SpecializedHoleFiller implements the HoleFiller algorithms for a weight
+ * function and a connectivity known at compile time. The weight is inlined
+ * in the inner loops and the neighbor loops are unrolled, instead of calling
+ * a std::function and checking the connectivity for every neighbor.
+ *
+ * @tparam Weight A type with a static
+ * `double GetWeight (const Pixel &, const Pixel &, double epsilon)`.
+ * @tparam Connectivity CONNECTIVITY_OPTION_1 or CONNECTIVITY_OPTION_2.
+ */
+template <typename Weight, int Connectivity>
+class SpecializedHoleFiller : public Neighborhood<Connectivity> {
+ public:
+  using Neighborhood<Connectivity>::ForEachNeighbor;
+
+  /**
+   * @brief Adds the weighted boundary values and the weights of boundary
+   * pixels for a single hole pixel.
+   *
+   * @tparam Channels The amount of channels of the image, 1 or
+   * COLOR_CHANNELS.
+   * @param holePixel The coordinates of the hole pixel.
+   * @param boundaryCoordinates The coordinates of the boundary pixels.
+   * @param boundaryValues The values of the channels of the boundary pixels.
+   * @param epsilon The epsilon of the weight function.
+   * @param dividendSums The sums of the weighted values of every channel.
+   * @param divisorSum A reference to the sum of the weights.
+   */
+  template <int Channels>
+  static void AccumulateRegularPixel (
+      const Pixel &holePixel, const std::vector<Pixel> &boundaryCoordinates,
+      const std::vector<float> &boundaryValues, const double epsilon,
+      double *dividendSums, double &divisorSum)
+  {
+    for (std::size_t i = 0; i < boundaryCoordinates.size (); ++i)
+      {
+        double currWeightValue = Weight::GetWeight (
+            holePixel, boundaryCoordinates[i], epsilon);
+        for (int c = 0; c < Channels; ++c)
+          {
+            dividendSums[c] += (boundaryValues[i * Channels + c]
+                                * currWeightValue);
+          }
+        divisorSum += currWeightValue;
+      }
+  }
+
+  /**
+   * @brief Fills the hole pixels using the regular algorithm, see
+   * HoleFiller::RegularAlgorithm.
+   *
+   * @tparam Channels The amount of channels of the image, 1 or
+   * COLOR_CHANNELS.
+   * @param holePixels The coordinates of the hole pixels.
+   * @param boundaryCoordinates The coordinates of the boundary pixels.
+   * @param boundaryValues The values of the channels of the boundary pixels.
+   * @param epsilon The epsilon of the weight function.
+   * @param threadCount The number of threads to use.
+   * @param filledImage The output image with the hole filled.
+   */
+  template <int Channels>
+  static void RegularAlgorithm (const std::vector<Pixel> &holePixels,
+                                const std::vector<Pixel> &boundaryCoordinates,
+                                const std::vector<float> &boundaryValues,
+                                const double epsilon, const int threadCount,
+                                Mat &filledImage)
+  {
+    ParallelFor (holePixels.size (), threadCount,
+                 [&] (std::size_t begin, std::size_t end)
+                 {
+                   for (std::size_t j = begin; j < end; ++j)
+                     {
+                       const Pixel &holePixel = holePixels[j];
+                       double dividendSums[Channels] = {};
+                       double divisorSum = 0;
+                       AccumulateRegularPixel<Channels> (
+                           holePixel, boundaryCoordinates, boundaryValues,
+                           epsilon, dividendSums, divisorSum);
+
+                       float *filledPixel =
+                           filledImage.ptr<float> (holePixel.first)
+                           + holePixel.second * Channels;
+                       for (int c = 0; c < Channels; ++c)
+                         {
+                           filledPixel[c] = (dividendSums[c] / divisorSum);
+                         }
+                     }
+                 });
+  }
+
+  /**
+   * @brief Adds the regular algorithm sums of boundary pixels, times a sign,
+   * to the sums of hole pixels, see HoleFiller::AccumulateRegularSums.
+   *
+   * @tparam Channels The amount of channels of the image, 1 or
+   * COLOR_CHANNELS.
+   * @param holePixels The coordinates of the hole pixels.
+   * @param boundaryCoordinates The coordinates of the boundary pixels.
+   * @param boundaryValues The values of the channels of the boundary pixels.
+   * @param epsilon The epsilon of the weight function.
+   * @param sign 1 to add the boundary pixels, -1 to subtract them.
+   * @param threadCount The number of threads to use.
+   * @param dividendSums The CV_64F sums of the weighted values of every
+   * channel of every pixel.
+   * @param divisorSums The CV_64FC1 sums of the weights of every pixel.
+   */
+  template <int Channels>
+  static void AccumulateRegularSums (
+      const std::vector<Pixel> &holePixels,
+      const std::vector<Pixel> &boundaryCoordinates,
+      const std::vector<float> &boundaryValues, const double epsilon,
+      const double sign, const int threadCount, Mat &dividendSums,
+      Mat &divisorSums)
+  {
+    ParallelFor (holePixels.size (), threadCount,
+                 [&] (std::size_t begin, std::size_t end)
+                 {
+                   for (std::size_t j = begin; j < end; ++j)
+                     {
+                       const Pixel &holePixel = holePixels[j];
+                       double pixelDividendSums[Channels] = {};
+                       double pixelDivisorSum = 0;
+                       AccumulateRegularPixel<Channels> (
+                           holePixel, boundaryCoordinates, boundaryValues,
+                           epsilon, pixelDividendSums, pixelDivisorSum);
+
+                       double *sums = dividendSums.ptr<double> (
+                                          holePixel.first)
+                                      + holePixel.second * Channels;
+                       for (int c = 0; c < Channels; ++c)
+                         {
+                           sums[c] += sign * pixelDividendSums[c];
+                         }
+                       divisorSums.ptr<double> (holePixel.first)
+                           [holePixel.second] += sign * pixelDivisorSum;
+                     }
+                 });
+  }
+
+  /**
+   * @brief Fills the hole pixels using the regular algorithm with sampled
+   * sums, see HoleFiller::SampledRegularAlgorithm.
+   *
+   * @tparam Channels The amount of channels of the image, 1 or
+   * COLOR_CHANNELS.
+   * @param sampler The sampler of the boundary pixels.
+   * @param holePixels The coordinates of the hole pixels.
+   * @param epsilon The epsilon of the weight function.
+   * @param threadCount The number of threads to use.
+   * @param filledImage The output image with the hole filled.
+   *
+   * @return The number of weights computed.
+   */
+  template <int Channels>
+  static long long SampledRegularAlgorithm (
+      const BoundarySampler &sampler, const std::vector<Pixel> &holePixels,
+      const double epsilon, const int threadCount, Mat &filledImage)
+  {
+    auto weight = [epsilon] (const Pixel &p1, const Pixel &p2)
+    {
+      return Weight::GetWeight (p1, p2, epsilon);
+    };
+    return sampler.template FillHolePixels<Channels> (holePixels, weight,
+                                                      threadCount,
+                                                      filledImage);
+  }
+
+  /**
+   * @brief Fills the hole pixels using the approximate algorithm, see
+   * HoleFiller::ApproximateAlgorithm.
+   *
+   * @tparam Channels The amount of channels of the image, 1 or
+   * COLOR_CHANNELS.
+   * @param layers The layers of the hole pixels.
+   * @param epsilon The epsilon of the weight function.
+   * @param options The sweep options.
+   * @param filledImage The output image with the hole filled.
+   *
+   * @return The number of sweeps run and the residual of the last one.
+   */
+  template <int Channels>
+  static SweepResult ApproximateAlgorithm (const HoleLayers &layers,
+                                           const double epsilon,
+                                           const SweepOptions &options,
+                                           Mat &filledImage)
+  {
+    auto update = [&] (const Pixel &holePixel, const int layer)
+    {
+      double dividendSums[Channels] = {};
+      double divisorSum = 0;
+
+      auto calculatePixelAffect = [&] (const Pixel &pixel)
+      {
+        // Neighbors outside the grid are outside the image.
+        if (!layers.Contains (pixel.first, pixel.second)) return;
+        if (layers.Get (pixel.first, pixel.second) > layer) return;
+
+        const float *values = filledImage.ptr<float> (pixel.first)
+                              + pixel.second * Channels;
+        if (values[0] == HOLE_VALUE) return;
+
+        double currWeightValue = Weight::GetWeight (holePixel, pixel, epsilon);
+        for (int c = 0; c < Channels; ++c)
+          {
+            dividendSums[c] += (values[c] * currWeightValue);
+          }
+        divisorSum += currWeightValue;
+      };
+      ForEachNeighbor (holePixel, calculatePixelAffect);
+
+      float *values = filledImage.ptr<float> (holePixel.first)
+                      + holePixel.second * Channels;
+      double change = 0;
+      for (int c = 0; c < Channels; ++c)
+        {
+          float newValue = (float) (dividendSums[c] / divisorSum);
+          change = std::max (change, (double) std::fabs (newValue - values[c]));
+          values[c] = newValue;
+        }
+      return change;
+    };
+
+    return RunSweeps (layers, Connectivity, options, update);
+  }
+};
+
+/**
+ * @brief Calls `call.Run<SpecializedHoleFiller<DistancePowerWeight<Z>, C>> ()`
+ * for the specialization matching a connectivity given at run time.
+ */
+template <int Z, typename Call>
+void DispatchConnectivity (const int connectivity, const Call &call)
+{
+  if (connectivity == CONNECTIVITY_OPTION_2)
+    {
+      call.template Run<SpecializedHoleFiller<DistancePowerWeight<Z>,
+                                              CONNECTIVITY_OPTION_2>> ();
+    }
+  else
+    {
+      call.template Run<SpecializedHoleFiller<DistancePowerWeight<Z>,
+                                              CONNECTIVITY_OPTION_1>> ();
+    }
+}
+
+/**
+ * @brief Calls `call.Run<SpecializedHoleFiller<DistancePowerWeight<Z>, C>> ()`
+ * for the specialization matching a z and a connectivity given at run time.
+ *
+ * @return False if there is no specialization for z, in which case the call
+ * is not made.
+ */
+template <typename Call>
+bool DispatchDistancePowerSpecialization (const int z, const int connectivity,
+                                          const Call &call)
+{
+  switch (z)
+    {
+      case 1:
+        DispatchConnectivity<1> (connectivity, call);
+      return true;
+
+      case 2:
+        DispatchConnectivity<2> (connectivity, call);
+      return true;
+
+      case 3:
+        DispatchConnectivity<3> (connectivity, call);
+      return true;
+
+      case 4:
+        DispatchConnectivity<4> (connectivity, call);
+      return true;
+
+      case 5:
+        DispatchConnectivity<5> (connectivity, call);
+      return true;
+
+      case 6:
+        DispatchConnectivity<6> (connectivity, call);
+      return true;
+    }
+
+  return false;
+}
+
+#endif // SPECIALIZED_HOLE_FILLER_H
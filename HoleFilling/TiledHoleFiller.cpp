@@ -0,0 +1,305 @@
+#include "TiledHoleFiller.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include "ImageMasker.h"
+
+#define MSG_ERR_TILED_OPEN "Error: Could not open a binary PGM or PPM file with 8-bit samples: "
+#define MSG_ERR_TILED_SIZE "Error: Images have different sizes"
+#define MSG_ERR_TILED_READ "Error: Could not read "
+#define MSG_ERR_TILED_WRITE "Error: Could not write "
+
+TiledHoleFiller::TiledHoleFiller (HoleFiller &hole_filler,
+                                  const int connectivity, const bool color)
+    : holeFiller_ (hole_filler), connectivity_ (connectivity), color_ (color),
+      tilesAmount_ (0)
+{}
+
+bool TiledHoleFiller::FillFile (const std::string &imagePath,
+                                const std::string &maskPath,
+                                const std::string &outputPath)
+{
+  tilesAmount_ = 0;
+
+  NetpbmReader image;
+  NetpbmReader mask;
+  if (!image.Open (imagePath))
+    {
+      std::cerr << MSG_ERR_TILED_OPEN << imagePath << std::endl;
+      return false;
+    }
+  if (!mask.Open (maskPath))
+    {
+      std::cerr << MSG_ERR_TILED_OPEN << maskPath << std::endl;
+      return false;
+    }
+  if (image.Rows () != mask.Rows () || image.Cols () != mask.Cols ())
+    {
+      std::cerr << MSG_ERR_TILED_SIZE << std::endl;
+      return false;
+    }
+
+  std::vector<PixelBounds> tileBounds;
+  {
+    std::vector<PixelBounds> holeBounds;
+    if (!FindHoleBounds (mask, holeBounds))
+      {
+        std::cerr << MSG_ERR_TILED_READ << maskPath << std::endl;
+        return false;
+      }
+    MergeTiles (holeBounds, image.Rows (), image.Cols (), tileBounds);
+  }
+
+  int channels = color_ ? COLOR_CHANNELS : 1;
+  NetpbmWriter output;
+  if (!output.Open (outputPath, image.Rows (), image.Cols (), channels))
+    {
+      std::cerr << MSG_ERR_TILED_WRITE << outputPath << std::endl;
+      return false;
+    }
+
+  // The tiles whose rows are being written.
+  std::vector<Tile> tiles;
+  std::size_t nextTile = 0;
+  Mat row;
+  Mat maskRow;
+  std::vector<uchar> samples ((std::size_t) image.Cols () * channels);
+  for (int x = 0; x < image.Rows (); ++x)
+    {
+      while (nextTile < tileBounds.size () && tileBounds[nextTile].minX == x)
+        {
+          Tile tile;
+          tile.bounds = tileBounds[nextTile++];
+          if (!FillTile (image, mask, tile))
+            {
+              std::cerr << MSG_ERR_TILED_READ << imagePath << std::endl;
+              return false;
+            }
+          tiles.push_back (std::move (tile));
+          tilesAmount_++;
+        }
+
+      if (!image.Read (x, 0, 1, image.Cols (), row)
+          || !mask.Read (x, 0, 1, mask.Cols (), maskRow))
+        {
+          std::cerr << MSG_ERR_TILED_READ << imagePath << std::endl;
+          return false;
+        }
+
+      // Every hole pixel of the row lies in a tile and is overwritten.
+      Mat maskedRow = MaskPixels (row, maskRow);
+      float *values = maskedRow.ptr<float> (0);
+      for (const Tile &tile : tiles)
+        {
+          const float *filled = tile.filled.ptr<float> (x - tile.bounds.minX);
+          int length = (tile.bounds.maxY - tile.bounds.minY + 1) * channels;
+          std::copy (filled, filled + length,
+                     values + tile.bounds.minY * channels);
+        }
+      for (std::size_t i = 0; i < samples.size (); ++i)
+        {
+          samples[i] = saturate_cast<uchar> (values[i]);
+        }
+
+      if (!output.WriteRow (samples.data ()))
+        {
+          std::cerr << MSG_ERR_TILED_WRITE << outputPath << std::endl;
+          return false;
+        }
+
+      tiles.erase (std::remove_if (tiles.begin (), tiles.end (),
+                                   [x] (const Tile &tile)
+                                   {
+                                     return tile.bounds.maxX == x;
+                                   }),
+                   tiles.end ());
+    }
+
+  if (!output.Close ())
+    {
+      std::cerr << MSG_ERR_TILED_WRITE << outputPath << std::endl;
+      return false;
+    }
+
+  return true;
+}
+
+std::size_t TiledHoleFiller::GetTilesAmount () const
+{
+  return tilesAmount_;
+}
+
+bool TiledHoleFiller::FindHoleBounds (
+    NetpbmReader &mask, std::vector<PixelBounds> &holeBounds) const
+{
+  // Runs of rows next to each other touch when they share a column, or in
+  // 8-connectivity also when they share a corner.
+  int reach = (connectivity_ == CONNECTIVITY_OPTION_2) ? 1 : 0;
+
+  std::vector<HoleRun> runs;
+  std::size_t previousBegin = 0;
+  std::size_t previousEnd = 0;
+  Mat row;
+  std::vector<uchar> holes (mask.Cols ());
+  for (int x = 0; x < mask.Rows (); ++x)
+    {
+      if (!mask.Read (x, 0, 1, mask.Cols (), row)) return false;
+      ImageMasker::GetHoleRow (row, 0, holes.data ());
+
+      std::size_t currentBegin = runs.size ();
+      std::size_t previous = previousBegin;
+      for (int y = 0; y < mask.Cols (); ++y)
+        {
+          if (!holes[y]) continue;
+
+          int begin = y;
+          while (y + 1 < mask.Cols () && holes[y + 1])
+            {
+              y++;
+            }
+          std::size_t current = runs.size ();
+          runs.push_back (HoleRun {x, begin, y, current});
+
+          // The runs of both rows are sorted, so the runs of the previous
+          // row before this one do not touch the next ones either.
+          while (previous < previousEnd && runs[previous].end + reach < begin)
+            {
+              previous++;
+            }
+          for (std::size_t i = previous;
+               i < previousEnd && runs[i].begin - reach <= y; ++i)
+            {
+              std::size_t root = FindRoot (runs, i);
+              std::size_t currentRoot = FindRoot (runs, current);
+              runs[std::max (root, currentRoot)].parent =
+                  std::min (root, currentRoot);
+            }
+        }
+
+      previousBegin = currentBegin;
+      previousEnd = runs.size ();
+    }
+
+  // A root comes before the other runs of its hole.
+  std::vector<std::size_t> holeIndices (runs.size ());
+  for (std::size_t i = 0; i < runs.size (); ++i)
+    {
+      std::size_t root = FindRoot (runs, i);
+      if (root == i)
+        {
+          holeIndices[i] = holeBounds.size ();
+          holeBounds.push_back (PixelBounds {runs[i].row, runs[i].begin,
+                                             runs[i].row, runs[i].end});
+          continue;
+        }
+
+      PixelBounds &bounds = holeBounds[holeIndices[root]];
+      bounds.maxX = std::max (bounds.maxX, runs[i].row);
+      bounds.minY = std::min (bounds.minY, runs[i].begin);
+      bounds.maxY = std::max (bounds.maxY, runs[i].end);
+    }
+
+  return true;
+}
+
+void TiledHoleFiller::MergeTiles (std::vector<PixelBounds> &holeBounds,
+                                  const int rows, const int cols,
+                                  std::vector<PixelBounds> &tiles)
+{
+  for (PixelBounds &bounds : holeBounds)
+    {
+      bounds.minX = std::max (bounds.minX - 1, 0);
+      bounds.minY = std::max (bounds.minY - 1, 0);
+      bounds.maxX = std::min (bounds.maxX + 1, rows - 1);
+      bounds.maxY = std::min (bounds.maxY + 1, cols - 1);
+    }
+
+  std::sort (holeBounds.begin (), holeBounds.end (),
+             [] (const PixelBounds &bounds, const PixelBounds &other)
+             {
+               return bounds.minX < other.minX;
+             });
+
+  // Holes of different bands share no row, and holes of different groups of
+  // a band share no column, so no hole crosses the bounds of a tile.
+  std::size_t bandBegin = 0;
+  while (bandBegin < holeBounds.size ())
+    {
+      std::size_t bandEnd = bandBegin + 1;
+      int bandMaxX = holeBounds[bandBegin].maxX;
+      while (bandEnd < holeBounds.size ()
+             && holeBounds[bandEnd].minX <= bandMaxX)
+        {
+          bandMaxX = std::max (bandMaxX, holeBounds[bandEnd].maxX);
+          bandEnd++;
+        }
+
+      std::sort (holeBounds.begin () + bandBegin,
+                 holeBounds.begin () + bandEnd,
+                 [] (const PixelBounds &bounds, const PixelBounds &other)
+                 {
+                   return bounds.minY < other.minY;
+                 });
+
+      std::size_t groupBegin = bandBegin;
+      while (groupBegin < bandEnd)
+        {
+          PixelBounds tile = holeBounds[groupBegin];
+          std::size_t groupEnd = groupBegin + 1;
+          while (groupEnd < bandEnd && holeBounds[groupEnd].minY <= tile.maxY)
+            {
+              tile.minX = std::min (tile.minX, holeBounds[groupEnd].minX);
+              tile.maxX = std::max (tile.maxX, holeBounds[groupEnd].maxX);
+              tile.maxY = std::max (tile.maxY, holeBounds[groupEnd].maxY);
+              groupEnd++;
+            }
+
+          tiles.push_back (tile);
+          groupBegin = groupEnd;
+        }
+
+      bandBegin = bandEnd;
+    }
+
+  std::sort (tiles.begin (), tiles.end (),
+             [] (const PixelBounds &bounds, const PixelBounds &other)
+             {
+               return bounds.minX < other.minX;
+             });
+}
+
+bool TiledHoleFiller::FillTile (NetpbmReader &image, NetpbmReader &mask,
+                                Tile &tile)
+{
+  const PixelBounds &bounds = tile.bounds;
+  int rows = bounds.maxX - bounds.minX + 1;
+  int cols = bounds.maxY - bounds.minY + 1;
+
+  Mat pixels;
+  Mat maskPixels;
+  if (!image.Read (bounds.minX, bounds.minY, rows, cols, pixels)
+      || !mask.Read (bounds.minX, bounds.minY, rows, cols, maskPixels))
+    return false;
+
+  tile.filled = holeFiller_.FillImage (MaskPixels (pixels, maskPixels));
+  return true;
+}
+
+Mat TiledHoleFiller::MaskPixels (const Mat &pixels, const Mat &maskPixels) const
+{
+  return color_ ? ImageMasker::ApplyMaskColor (pixels, maskPixels)
+                : ImageMasker::ApplyMask (pixels, maskPixels);
+}
+
+std::size_t TiledHoleFiller::FindRoot (std::vector<HoleRun> &runs,
+                                       std::size_t run)
+{
+  while (runs[run].parent != run)
+    {
+      runs[run].parent = runs[runs[run].parent].parent;
+      run = runs[run].parent;
+    }
+  return run;
+}
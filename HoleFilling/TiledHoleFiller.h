@@ -0,0 +1,117 @@
+#ifndef TILED_HOLE_FILLER_H
+#define TILED_HOLE_FILLER_H
+
+#include <string>
+#include <vector>
+
+#include "HoleFiller.h"
+#include "NetpbmFile.h"
+
+/**
+ * TiledHoleFiller fills images too large to be in memory, stored as binary
+ * PGM or PPM files. The mask is streamed row by row once to find the holes:
+ * the runs of hole pixels of every row are joined to those of the previous
+ * row with a union-find, which only keeps the runs in memory. The bounds of
+ * the holes, grown by their boundary ring, are merged into disjoint tiles,
+ * such that every hole lies in a single tile. The output is then written
+ * row by row: rows without holes are masked like the tiles, and every tile
+ * is read, filled by the HoleFiller and kept only until its last row is
+ * written. The memory used depends on the size of the holes, not on the
+ * size of the image.
+ */
+class TiledHoleFiller {
+ public:
+  /**
+   * @brief Constructor for the TiledHoleFiller class.
+   *
+   * @param hole_filler The HoleFiller filling the tiles.
+   * @param connectivity The connectivity of the HoleFiller.
+   * @param color Fill the B, G and R channels instead of a grayscale image.
+   */
+  TiledHoleFiller (HoleFiller &hole_filler, int connectivity, bool color);
+
+  /**
+   * @brief Fills the holes of an image file. Errors are printed to the
+   * standard error stream.
+   *
+   * @param imagePath A binary PGM or PPM image file.
+   * @param maskPath A binary PGM or PPM mask file of the size of the image.
+   * @param outputPath The PGM file, or PPM file in color, to write.
+   *
+   * @return True if the filled image was written.
+   */
+  bool FillFile (const std::string &imagePath, const std::string &maskPath,
+                 const std::string &outputPath);
+
+  /**
+   * @brief Returns the number of tiles filled by the last FillFile call.
+   */
+  std::size_t GetTilesAmount () const;
+
+ private:
+  /**
+   * @brief A run of hole pixels of a mask row, and its union-find parent.
+   */
+  struct HoleRun {
+    int row;
+    int begin;
+    int end;
+    std::size_t parent;
+  };
+
+  /**
+   * @brief A tile being written, filled.
+   */
+  struct Tile {
+    PixelBounds bounds;
+    Mat filled;
+  };
+
+  HoleFiller &holeFiller_;
+  int connectivity_;
+  bool color_;
+  std::size_t tilesAmount_;
+
+  /**
+   * @brief Streams the mask and returns the bounds of its holes.
+   *
+   * @return False if the mask could not be read.
+   */
+  bool FindHoleBounds (NetpbmReader &mask,
+                       std::vector<PixelBounds> &holeBounds) const;
+
+  /**
+   * @brief Grows the bounds of the holes by their boundary ring, and merges
+   * them to disjoint tiles sorted by their first row: first to bands of
+   * holes with overlapping rows, then in every band to groups of holes with
+   * overlapping columns.
+   *
+   * @param holeBounds The bounds of the holes.
+   * @param rows The number of rows of the image.
+   * @param cols The number of columns of the image.
+   * @param tiles Output bounds of the tiles.
+   */
+  static void MergeTiles (std::vector<PixelBounds> &holeBounds, int rows,
+                          int cols, std::vector<PixelBounds> &tiles);
+
+  /**
+   * @brief Reads a tile of the image and of the mask, and fills its holes.
+   *
+   * @return False if the files could not be read.
+   */
+  bool FillTile (NetpbmReader &image, NetpbmReader &mask, Tile &tile);
+
+  /**
+   * @brief Masks pixels read from a file with the mask pixels of the same
+   * region, converting them to the channels of the output.
+   */
+  Mat MaskPixels (const Mat &pixels, const Mat &maskPixels) const;
+
+  /**
+   * @brief Returns the root of the union-find tree of a run, halving the
+   * path to it.
+   */
+  static std::size_t FindRoot (std::vector<HoleRun> &runs, std::size_t run);
+};
+
+#endif // TILED_HOLE_FILLER_H
@@ -1,6 +1,7 @@
 #ifndef WEIGHT_FUNCTION_H
 #define WEIGHT_FUNCTION_H
 
+#include <functional>
 #include <utility>
 
 /**
@@ -8,6 +9,12 @@
  */
 using Pixel = std::pair<int, int>;
 
+/**
+ * @brief Alias for a weight function taking two pixels, z and epsilon, like
+ * MyWeightFunction::GetWeight.
+ */
+typedef std::function<double (Pixel, Pixel, int, double)> WeightFunctionType;
+
 /**
  * @brief Abstract class representing a weight function.
  *
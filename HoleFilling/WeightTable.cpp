@@ -0,0 +1,134 @@
+#include "WeightTable.h"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <utility>
+
+#include "MyWeightFunction.h"
+
+// 128 MB of doubles, enough for offsets of up to 4096 x 4096.
+#define WEIGHT_TABLE_MAX_ENTRIES (1 << 24)
+// The cache keeps the most recently used tables up to this many entries in
+// total, the size of the largest table.
+#define WEIGHT_TABLE_CACHE_ENTRIES WEIGHT_TABLE_MAX_ENTRIES
+
+namespace {
+
+/**
+ * @brief A table of the cache with its (z, epsilon).
+ */
+struct CachedTable {
+  std::pair<int, double> parameters;
+  std::shared_ptr<const WeightTable> table;
+};
+
+/**
+ * @brief Returns the number of entries of a table.
+ */
+long long GetEntriesAmount (const WeightTable &table)
+{
+  return (long long) (table.ExtentX () + 1) * (table.ExtentY () + 1);
+}
+
+}
+
+WeightTable::WeightTable (const int z, const double epsilon,
+                          const int extentX, const int extentY,
+                          const WeightTable *previous)
+    : extentX_ (extentX), extentY_ (extentY),
+      weights_ ((extentX + 1) * (extentY + 1))
+{
+  Pixel origin (0, 0);
+  for (int dx = 0; dx <= extentX_; ++dx)
+    {
+      for (int dy = 0; dy <= extentY_; ++dy)
+        {
+          double weight;
+          if (previous != nullptr && dx <= previous->extentX_
+              && dy <= previous->extentY_)
+            {
+              weight = previous->GetWeight (dx, dy);
+            }
+          else
+            {
+              weight = MyWeightFunction::GetWeight (origin, Pixel (dx, dy),
+                                                    z, epsilon);
+            }
+          weights_[(dx * (extentY_ + 1)) + dy] = weight;
+        }
+    }
+}
+
+std::shared_ptr<const WeightTable>
+WeightTable::Get (const int z, const double epsilon, const int extentX,
+                  const int extentY)
+{
+  static std::mutex tablesMutex;
+  // The most recently used table first.
+  static std::list<CachedTable> tables;
+
+  std::lock_guard<std::mutex> lock (tablesMutex);
+
+  const std::pair<int, double> parameters (z, epsilon);
+  auto cachedTable = tables.begin ();
+  while (cachedTable != tables.end ()
+         && cachedTable->parameters != parameters)
+    {
+      ++cachedTable;
+    }
+  if (cachedTable == tables.end ())
+    {
+      cachedTable = tables.insert (tables.begin (),
+                                   CachedTable {parameters, nullptr});
+    }
+  else
+    {
+      tables.splice (tables.begin (), tables, cachedTable);
+    }
+  std::shared_ptr<const WeightTable> table = cachedTable->table;
+
+  if (table && table->extentX_ >= extentX && table->extentY_ >= extentY)
+    return table;
+
+  int newExtentX = extentX;
+  int newExtentY = extentY;
+  if (table)
+    {
+      newExtentX = std::max (newExtentX, table->extentX_);
+      newExtentY = std::max (newExtentY, table->extentY_);
+    }
+
+  if ((long long) (newExtentX + 1) * (newExtentY + 1)
+      > WEIGHT_TABLE_MAX_ENTRIES)
+    return nullptr;
+
+  table = std::shared_ptr<const WeightTable> (
+      new WeightTable (z, epsilon, newExtentX, newExtentY, table.get ()));
+  cachedTable->table = table;
+
+  // Evict the least recently used tables over the budget. Fills still
+  // holding them keep them until they are done.
+  long long entriesAmount = 0;
+  for (auto entry = tables.begin (); entry != tables.end ();)
+    {
+      if (entry->table)
+        {
+          entriesAmount += GetEntriesAmount (*entry->table);
+        }
+      if (entry != tables.begin ()
+          && (!entry->table || entriesAmount > WEIGHT_TABLE_CACHE_ENTRIES))
+        {
+          if (entry->table)
+            {
+              entriesAmount -= GetEntriesAmount (*entry->table);
+            }
+          entry = tables.erase (entry);
+        }
+      else
+        {
+          ++entry;
+        }
+    }
+  return table;
+}
@@ -0,0 +1,63 @@
+#ifndef WEIGHT_TABLE_H
+#define WEIGHT_TABLE_H
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/**
+ * WeightTable caches the MyWeightFunction weights by pixel offset.
+ *
+ * Pixel coordinates are integers and the weight only depends on
+ * (|dx|, |dy|, z, epsilon), so a single table of the weights of all the
+ * absolute offsets up to the hole extent replaces the pow and sqrt of every
+ * pixel pair. Tables are shared process wide per (z, epsilon), so later
+ * fills with the same parameters, from any HoleFiller, e.g. the jobs of a
+ * batch, reuse them. The cache keeps the most recently used tables, up to
+ * the entries of the largest table in total; an evicted table lives on
+ * while fills hold it. A table is never modified after it is built: a fill
+ * that needs a larger extent gets a new, larger table, and fills still
+ * holding the old one are not affected.
+ */
+class WeightTable {
+ public:
+  /**
+   * @brief Returns the shared table of (z, epsilon) covering offsets of up
+   * to extentX and extentY, building or extending it if needed.
+   *
+   * @param z The power to which the Euclidean distance is raised.
+   * @param epsilon The epsilon of the weight function.
+   * @param extentX The largest absolute x offset the table has to cover.
+   * @param extentY The largest absolute y offset the table has to cover.
+   *
+   * @return The table, or nullptr if it would exceed
+   * WEIGHT_TABLE_MAX_ENTRIES entries.
+   */
+  static std::shared_ptr<const WeightTable> Get (int z, double epsilon,
+                                                 int extentX, int extentY);
+
+  /**
+   * @brief Returns the weight of two pixels dx, dy apart. The offsets must
+   * be within the extents of the table.
+   */
+  double GetWeight (const int dx, const int dy) const
+  {
+    return weights_[(std::abs (dx) * (extentY_ + 1)) + std::abs (dy)];
+  }
+
+  int ExtentX () const
+  { return extentX_; }
+
+  int ExtentY () const
+  { return extentY_; }
+
+ private:
+  WeightTable (int z, double epsilon, int extentX, int extentY,
+               const WeightTable *previous);
+
+  int extentX_;
+  int extentY_;
+  std::vector<double> weights_;
+};
+
+#endif // WEIGHT_TABLE_H
@@ -1,12 +1,18 @@
 #include <opencv2/core.hpp>     // Core functionality of OpenCV
 #include <opencv2/imgcodecs.hpp> // Reading and writing image files
 
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <thread>
 
+#include "BatchPipeline.h"
 #include "ImageMasker.h"
 #include "MyWeightFunction.h"
 #include "HoleFiller.h"
+#include "SequenceFiller.h"
+#include "TiledHoleFiller.h"
 
 #define MSG_ERR_ARG_AMOUNT \
 "Error: Please provide the following command-line arguments:\n\
@@ -15,7 +21,38 @@
 - Value of z (integer)\n\
 - Value of epsilon (positive float)\n\
 - Connectivity type (4, or 8)\n\
-- Algorithem type (1, 2, or 3)"
+- Algorithem type (1, 2, 3, 4, 5, or 0 to choose per hole)\n\
+  Algorithm 5 averages all the neighbors of every hole pixel, not only those\n\
+  of the same or an outer layer like algorithm 2: its fill is visibly different\n\
+Optional arguments:\n\
+- --threads=N Number of threads used by the algorithm\n\
+- --error-tolerance=T Error tolerance of algorithm 4 (default 0.05)\n\
+- --samples=N Algorithm 1 samples N of the far boundary pixels of every hole\n\
+  pixel instead of summing all of them (default 0, all of them)\n\
+- --residual-tolerance=R Algorithm 2 stops when no pixel changes by more than R\n\
+  in a sweep (default 0)\n\
+- --max-sweeps=N Maximum number of sweeps of algorithm 2 (default 100)\n\
+- --colored-sweeps Algorithm 2 sweeps color by color, using all the threads\n\
+- --color Fill the B, G and R channels instead of a grayscale image\n\
+- --patch=PATH Save only the filled bounding box of the holes and their\n\
+  boundary to PATH, and print its offset in the image\n\
+- --report=json Print the time of every stage and counters of the fill as a\n\
+  JSON object, on the last line of the output\n\
+Batch mode: --batch=MANIFEST [optional arguments]\n\
+- MANIFEST has a row image,mask,output,z,epsilon,connectivity,algorithm\n\
+  per image to fill\n\
+- --fill-workers=N Number of images filled at once (default: all cores)\n\
+Sequence mode: --sequence=FRAMES MASK OUTPUT z epsilon connectivity algorithm\n\
+  [optional arguments]\n\
+- FRAMES and OUTPUT are paths with a frame number, e.g. frame%04d.png; the\n\
+  frames are read from frame 0 (or 1) up to the first missing one\n\
+- MASK is a mask path, or a path with a frame number for a mask per frame\n\
+- Algorithm 2 starts every frame from the previous filled frame, with a\n\
+  residual tolerance of 0.05 unless --residual-tolerance is given\n\
+Tiled mode: --tiled=OUTPUT IMAGE MASK z epsilon connectivity algorithm\n\
+  [optional arguments]\n\
+- IMAGE and MASK are binary PGM or PPM files, read a tile at a time, and\n\
+  OUTPUT is the PGM (or PPM with --color) file to write"
 
 #define MSG_ERR_OPEN_IMAGE "Error: Could not open the image file"
 #define MSG_ERR_OPEN_MASK_IMAGE "Error: Could not open the mask image file"
@@ -25,12 +62,42 @@
 #define MSG_ERR_CONNECTIVITY_VALUE \
                               "Error: Invalid value for connectivity number."
 #define MSG_ERR_ALGORITHM_TYPE "Error: Invalid value for Algorithm type."
+#define MSG_ERR_THREADS_VALUE "Error: threads should be a positive integer."
+#define MSG_ERR_ERROR_TOLERANCE_VALUE \
+                              "Error: error-tolerance should be a non negative number."
+#define MSG_ERR_SAMPLES_VALUE \
+                              "Error: samples should be a positive integer."
+#define MSG_ERR_RESIDUAL_TOLERANCE_VALUE \
+                              "Error: residual-tolerance should be a non negative number."
+#define MSG_ERR_MAX_SWEEPS_VALUE \
+                              "Error: max-sweeps should be a positive integer."
+#define MSG_ERR_FILL_WORKERS_VALUE \
+                              "Error: fill-workers should be a positive integer."
+#define MSG_ERR_BATCH_FAILED " batch jobs failed."
+#define MSG_ERR_FRAME_PATTERN \
+                              "Error: The frames and output paths should have a frame number, e.g. %04d."
+#define MSG_ERR_OPEN_FIRST_FRAME "Error: Could not open the first frame of "
+#define MSG_ERR_SAVE_FRAME "Error: Could not save the filled frame "
+#define MSG_ERR_UNKNOWN_OPTION "Error: Unknown optional argument: "
+#define MSG_ERR_SAVE_PATCH "Error: Could not save the filled patch "
+#define MSG_ERR_REPORT_VALUE "Error: report should be json."
 
 #define DISPLAY_IMAGE_NAME "Float Image"
 #define SAVING_IMAGE_NAME "filledImage.png"
+#define MSG_SWEEPS "Approximate algorithm sweeps: "
+#define MSG_RESIDUAL ", residual: "
+#define MSG_FRAME "Frame "
+#define MSG_FRAME_SAME_MASK " (same mask)"
+#define MSG_FRAME_SWEEPS ", sweeps: "
+#define MSG_PATCH_OFFSET "Patch offset (column, row): "
+#define MSG_PATCH_SEPARATOR ", "
+#define MSG_NO_HOLES "The mask has no hole pixels, no patch was saved."
 #define NULL_CHARACTER '\0'
 
 #define ARGUMENTS_AMOUNT 7
+#define BATCH_ARGUMENTS_AMOUNT 2
+#define SEQUENCE_ARGUMENTS_AMOUNT 8
+#define TILED_ARGUMENTS_AMOUNT 8
 
 #define ARGUMENT_VALUE_RGB_IMAGE 1
 #define ARGUMENT_VALUE_MASK_IMAGE 2
@@ -39,16 +106,47 @@
 #define ARGUMENT_VALUE_CONNECTIVITY 5
 #define ARGUMENT_VALUE_ALGORITHM_TYPE 6
 
+#define SEQUENCE_ARGUMENT_MASK 2
+#define SEQUENCE_ARGUMENT_OUTPUT 3
+#define SEQUENCE_ARGUMENT_Z 4
+#define SEQUENCE_ARGUMENT_EPSILON 5
+#define SEQUENCE_ARGUMENT_CONNECTIVITY 6
+#define SEQUENCE_ARGUMENT_ALGORITHM_TYPE 7
+
+#define TILED_ARGUMENT_IMAGE 2
+#define TILED_ARGUMENT_MASK 3
+#define TILED_ARGUMENT_Z 4
+#define TILED_ARGUMENT_EPSILON 5
+#define TILED_ARGUMENT_CONNECTIVITY 6
+#define TILED_ARGUMENT_ALGORITHM_TYPE 7
+
+#define OPTION_THREADS "--threads="
+#define OPTION_ERROR_TOLERANCE "--error-tolerance="
+#define OPTION_SAMPLES "--samples="
+#define OPTION_RESIDUAL_TOLERANCE "--residual-tolerance="
+#define OPTION_MAX_SWEEPS "--max-sweeps="
+#define OPTION_COLORED_SWEEPS "--colored-sweeps"
+#define OPTION_COLOR "--color"
+#define OPTION_BATCH "--batch="
+#define OPTION_FILL_WORKERS "--fill-workers="
+#define OPTION_SEQUENCE "--sequence="
+#define OPTION_TILED "--tiled="
+#define OPTION_PATCH "--patch="
+#define OPTION_REPORT "--report="
+#define REPORT_FORMAT_JSON "json"
+#define DEFAULT_THREADS_AMOUNT 1
+
 #define STRTOL_BASE 10
 
 /**
  * @brief This function checks if the number of command-line arguments
- * is equal to a pre-defined value - ARGUMENTS_AMOUNT.
+ * is at least a pre-defined value - ARGUMENTS_AMOUNT. Any further
+ * arguments are optional arguments.
  */
 
 bool ArgumentAmountCheck (int argc)
 {
-  if (argc != ARGUMENTS_AMOUNT)
+  if (argc < ARGUMENTS_AMOUNT)
     {
       std::cerr << MSG_ERR_ARG_AMOUNT << std::endl;
       return false;
@@ -111,7 +209,7 @@ bool NumbersCheck (const char *endPtr, const std::string &errorMassage)
  * @param endPtrE Pointer to string representing the epsilon value.
  * @param connectivity Connectivity type (4 or 8).
  * @param endPtrC Pointer to string representing the connectivity value.
- * @param algorithmType Algorithm type (1, 2).
+ * @param algorithmType Algorithm type (0, 1, 2, 3, 4, 5).
  * @param endPtrA Pointer to string representing the algorithm type.
  *
  * @return True if all the input arguments are valid, false otherwise.
@@ -145,16 +243,466 @@ ArgumentNumbersCheck (const char *endPtrZ, const float e,
   if (!NumbersCheck (endPtrA, MSG_ERR_ALGORITHM_TYPE))
     return false;
 
-  if (algorithmType != ALGORITHM_OPTION_ONE
-      && algorithmType != ALGORITHM_OPTION_TWO)
+  if (algorithmType != ALGORITHM_OPTION_AUTO
+      && algorithmType != ALGORITHM_OPTION_ONE
+      && algorithmType != ALGORITHM_OPTION_TWO
+      && algorithmType != ALGORITHM_OPTION_THREE
+      && algorithmType != ALGORITHM_OPTION_FOUR
+      && algorithmType != ALGORITHM_OPTION_FIVE)
     {
       std::cerr << MSG_ERR_ALGORITHM_TYPE << std::endl;
+      return false;
+    }
+
+  return true;
+}
+
+/**
+ * @brief This function parses the z value, epsilon value, connectivity type
+ * and algorithm type arguments, and checks them with ArgumentNumbersCheck.
+ *
+ * @return True if all the arguments are valid, false otherwise.
+ */
+bool ParseArgumentNumbers (const char *zArgument, const char *epsilonArgument,
+                           const char *connectivityArgument,
+                           const char *algorithmTypeArgument, int &z,
+                           float &epsilon, int &connectivity,
+                           int &algorithmType)
+{
+  char *endPtrZ;
+  z = (int) std::strtol (zArgument, &endPtrZ, STRTOL_BASE);
+
+  epsilon = std::stof (epsilonArgument);
+
+  char *endPtrC;
+  connectivity = (int) std::strtol (connectivityArgument, &endPtrC,
+                                    STRTOL_BASE);
+
+  char *endPtrA;
+  algorithmType = (int) std::strtol (algorithmTypeArgument, &endPtrA,
+                                     STRTOL_BASE);
+
+  return ArgumentNumbersCheck (endPtrZ, epsilon, connectivity, endPtrC,
+                               algorithmType, endPtrA);
+}
+
+/**
+ * @brief This function checks if an argument starts with a given option
+ * prefix (e.g. "--threads=").
+ */
+bool IsOption (const std::string &argument, const std::string &option)
+{
+  return argument.compare (0, option.size (), option) == 0;
+}
+
+/**
+ * @brief Values of the optional command-line arguments.
+ */
+struct OptionalArguments {
+  int threads = DEFAULT_THREADS_AMOUNT;
+  double errorTolerance = DEFAULT_APPROXIMATION_TOLERANCE;
+  int samples = DEFAULT_SAMPLE_BUDGET;
+  double residualTolerance = DEFAULT_RESIDUAL_TOLERANCE;
+  bool residualToleranceGiven = false;
+  int maxSweeps = APPROXIMATE_ALGORITHM_ROUTINE_AMOUNT;
+  bool coloredSweeps = false;
+  bool color = false;
+  int fillWorkers = (int) std::max (std::thread::hardware_concurrency (), 1u);
+  std::string patchPath;
+  bool jsonReport = false;
+};
+
+/**
+ * @brief This function parses a positive integer given as the value of an
+ * optional argument.
+ *
+ * @param value The text following the option prefix.
+ * @param errorMassage A string message to print to the
+ * standard error stream if the value is invalid.
+ * @param result Output for the parsed value.
+ */
+bool ParsePositiveInteger (const char *value, const std::string &errorMassage,
+                           int &result)
+{
+  char *endPtr;
+  result = (int) std::strtol (value, &endPtr, STRTOL_BASE);
+  if (!NumbersCheck (endPtr, errorMassage)) return false;
+
+  if (*value == NULL_CHARACTER || result <= 0)
+    {
+      std::cerr << errorMassage << std::endl;
+      return false;
+    }
+
+  return true;
+}
 
+/**
+ * @brief This function parses a non negative number given as the value of an
+ * optional argument.
+ *
+ * @param value The text following the option prefix.
+ * @param errorMassage A string message to print to the
+ * standard error stream if the value is invalid.
+ * @param result Output for the parsed value.
+ */
+bool ParseNonNegativeNumber (const char *value,
+                             const std::string &errorMassage, double &result)
+{
+  char *endPtr;
+  result = std::strtod (value, &endPtr);
+  if (!NumbersCheck (endPtr, errorMassage)) return false;
+
+  if (*value == NULL_CHARACTER || result < 0)
+    {
+      std::cerr << errorMassage << std::endl;
+      return false;
+    }
+
+  return true;
+}
+
+/**
+ * @brief This function parses the optional arguments given after the
+ * positional arguments.
+ *
+ * @param argc The number of arguments passed in from the command line.
+ * @param argv The command line arguments.
+ * @param firstOptional The index of the first optional argument.
+ * @param options Output for the parsed values.
+ *
+ * @return True if all the optional arguments are valid, false otherwise.
+ */
+bool ParseOptionalArguments (int argc, char **argv, int firstOptional,
+                             OptionalArguments &options)
+{
+  for (int i = firstOptional; i < argc; ++i)
+    {
+      std::string argument (argv[i]);
+
+      if (IsOption (argument, OPTION_THREADS))
+        {
+          const char *value = argv[i] + std::strlen (OPTION_THREADS);
+          if (!ParsePositiveInteger (value, MSG_ERR_THREADS_VALUE,
+                                     options.threads))
+            return false;
+        }
+      else if (IsOption (argument, OPTION_ERROR_TOLERANCE))
+        {
+          const char *value = argv[i] + std::strlen (OPTION_ERROR_TOLERANCE);
+          if (!ParseNonNegativeNumber (value, MSG_ERR_ERROR_TOLERANCE_VALUE,
+                                       options.errorTolerance))
+            return false;
+        }
+      else if (IsOption (argument, OPTION_SAMPLES))
+        {
+          const char *value = argv[i] + std::strlen (OPTION_SAMPLES);
+          if (!ParsePositiveInteger (value, MSG_ERR_SAMPLES_VALUE,
+                                     options.samples))
+            return false;
+        }
+      else if (IsOption (argument, OPTION_RESIDUAL_TOLERANCE))
+        {
+          const char *value = argv[i] + std::strlen (OPTION_RESIDUAL_TOLERANCE);
+          if (!ParseNonNegativeNumber (value, MSG_ERR_RESIDUAL_TOLERANCE_VALUE,
+                                       options.residualTolerance))
+            return false;
+          options.residualToleranceGiven = true;
+        }
+      else if (IsOption (argument, OPTION_MAX_SWEEPS))
+        {
+          const char *value = argv[i] + std::strlen (OPTION_MAX_SWEEPS);
+          if (!ParsePositiveInteger (value, MSG_ERR_MAX_SWEEPS_VALUE,
+                                     options.maxSweeps))
+            return false;
+        }
+      else if (argument == OPTION_COLORED_SWEEPS)
+        {
+          options.coloredSweeps = true;
+        }
+      else if (argument == OPTION_COLOR)
+        {
+          options.color = true;
+        }
+      else if (IsOption (argument, OPTION_FILL_WORKERS))
+        {
+          const char *value = argv[i] + std::strlen (OPTION_FILL_WORKERS);
+          if (!ParsePositiveInteger (value, MSG_ERR_FILL_WORKERS_VALUE,
+                                     options.fillWorkers))
+            return false;
+        }
+      else if (IsOption (argument, OPTION_PATCH))
+        {
+          options.patchPath = argument.substr (std::strlen (OPTION_PATCH));
+        }
+      else if (IsOption (argument, OPTION_REPORT))
+        {
+          if (argument.substr (std::strlen (OPTION_REPORT))
+              != REPORT_FORMAT_JSON)
+            {
+              std::cerr << MSG_ERR_REPORT_VALUE << std::endl;
+              return false;
+            }
+          options.jsonReport = true;
+        }
+      else
+        {
+          std::cerr << MSG_ERR_UNKNOWN_OPTION << argument << std::endl;
+          return false;
+        }
     }
 
   return true;
 }
 
+/**
+ * @brief This function applies the optional arguments to a HoleFiller.
+ */
+void ApplyOptionalArguments (const OptionalArguments &options,
+                             HoleFiller &holeFiller)
+{
+  holeFiller.SetApproximationTolerance (options.errorTolerance);
+  holeFiller.SetSampleBudget (options.samples);
+  holeFiller.SetConvergenceCriteria (options.residualTolerance,
+                                     options.maxSweeps);
+  holeFiller.SetColoredSweeps (options.coloredSweeps);
+}
+
+/**
+ * @brief The time of the stages of the single image mode done outside the
+ * HoleFiller, in seconds.
+ */
+struct StageTimes {
+  double read = 0;
+  double applyMask = 0;
+  double write = 0;
+};
+
+/**
+ * @brief Returns the seconds elapsed since a time point.
+ */
+double GetSecondsSince (const std::chrono::steady_clock::time_point &start)
+{
+  return std::chrono::duration<double> (std::chrono::steady_clock::now ()
+                                        - start).count ();
+}
+
+/**
+ * @brief This function prints the report of a fill as a single line JSON
+ * object: the time of every stage in seconds, the counters of the
+ * HoleFiller, and the region of the image that was filled.
+ */
+void PrintJsonReport (const StageTimes &times,
+                      const FillStatistics &statistics, const Rect &holeRoi)
+{
+  std::cout << "{\"stages\": {"
+            << "\"read\": " << times.read
+            << ", \"apply_mask\": " << times.applyMask
+            << ", \"find_holes\": " << statistics.findHolesSeconds
+            << ", \"prepare_holes\": " << statistics.prepareSeconds
+            << ", \"fill\": " << statistics.fillSeconds
+            << ", \"write\": " << times.write << "}"
+            << ", \"counters\": {"
+            << "\"holes\": " << statistics.holesAmount
+            << ", \"hole_pixels\": " << statistics.holePixelsAmount
+            << ", \"boundary_pixels\": " << statistics.boundaryPixelsAmount
+            << ", \"weight_evaluations\": " << statistics.weightEvaluations
+            << ", \"sweeps\": " << statistics.sweepsAmount
+            << ", \"layers\": " << statistics.layersAmount << "}"
+            << ", \"region\": {"
+            << "\"x\": " << holeRoi.x << ", \"y\": " << holeRoi.y
+            << ", \"width\": " << holeRoi.width
+            << ", \"height\": " << holeRoi.height << "}}" << std::endl;
+}
+
+/**
+ * @brief This function runs the batch mode: it fills the images of the
+ * manifest given by the OPTION_BATCH argument with a BatchPipeline.
+ *
+ * @return An integer representing the success or failure of the batch
+ * (0 if all the jobs succeeded, 1 otherwise).
+ */
+int RunBatch (int argc, char **argv)
+{
+  const char *manifestPath = argv[1] + std::strlen (OPTION_BATCH);
+
+  OptionalArguments options;
+  if (!(ParseOptionalArguments (argc, argv, BATCH_ARGUMENTS_AMOUNT, options)))
+    return 1;
+
+  std::vector<BatchJob> jobs;
+  if (!BatchPipeline::ReadManifest (manifestPath, jobs)) return 1;
+
+  BatchPipeline pipeline (options.fillWorkers, options.threads, options.color,
+                          [&options] (HoleFiller &holeFiller)
+                          {
+                            ApplyOptionalArguments (options, holeFiller);
+                          });
+  std::size_t failedJobs = pipeline.Run (jobs);
+  if (failedJobs > 0)
+    {
+      std::cerr << failedJobs << MSG_ERR_BATCH_FAILED << std::endl;
+      return 1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief This function runs the sequence mode: it fills the frames given by
+ * the OPTION_SEQUENCE argument one after the other with a SequenceFiller,
+ * and saves them to the output path of their frame number.
+ *
+ * @return An integer representing the success or failure of the sequence
+ * (0 for success, 1 for failure).
+ */
+int RunSequence (int argc, char **argv)
+{
+  if (argc < SEQUENCE_ARGUMENTS_AMOUNT)
+    {
+      std::cerr << MSG_ERR_ARG_AMOUNT << std::endl;
+      return 1;
+    }
+
+  std::string framesPattern (argv[1] + std::strlen (OPTION_SEQUENCE));
+  std::string maskPath (argv[SEQUENCE_ARGUMENT_MASK]);
+  std::string outputPattern (argv[SEQUENCE_ARGUMENT_OUTPUT]);
+  if (!SequenceFiller::IsFramePattern (framesPattern)
+      || !SequenceFiller::IsFramePattern (outputPattern))
+    {
+      std::cerr << MSG_ERR_FRAME_PATTERN << std::endl;
+      return 1;
+    }
+
+  int z;
+  float epsilon;
+  int connectivity;
+  int algorithmType;
+  if (!(ParseArgumentNumbers (argv[SEQUENCE_ARGUMENT_Z],
+                              argv[SEQUENCE_ARGUMENT_EPSILON],
+                              argv[SEQUENCE_ARGUMENT_CONNECTIVITY],
+                              argv[SEQUENCE_ARGUMENT_ALGORITHM_TYPE], z,
+                              epsilon, connectivity, algorithmType)))
+    return 1;
+
+  OptionalArguments options;
+  if (!(ParseOptionalArguments (argc, argv, SEQUENCE_ARGUMENTS_AMOUNT,
+                                options)))
+    return 1;
+  if (!options.residualToleranceGiven)
+    {
+      options.residualTolerance = SEQUENCE_RESIDUAL_TOLERANCE;
+    }
+
+  HoleFiller holeFiller (z, epsilon, connectivity, algorithmType,
+                         &MyWeightFunction::GetWeight, options.threads);
+  ApplyOptionalArguments (options, holeFiller);
+  SequenceFiller sequenceFiller (holeFiller, options.color, options.threads);
+
+  // The frames are numbered from 0 or from 1.
+  int frameNumber = 0;
+  Mat frame = imread (SequenceFiller::FormatFramePath (framesPattern,
+                                                       frameNumber),
+                      IMREAD_COLOR);
+  if (frame.empty ())
+    {
+      frameNumber = 1;
+      frame = imread (SequenceFiller::FormatFramePath (framesPattern,
+                                                       frameNumber),
+                      IMREAD_COLOR);
+    }
+  if (frame.empty ())
+    {
+      std::cerr << MSG_ERR_OPEN_FIRST_FRAME << framesPattern << std::endl;
+      return 1;
+    }
+
+  bool maskPerFrame = SequenceFiller::IsFramePattern (maskPath);
+  Mat maskImage;
+  if (!maskPerFrame) maskImage = imread (maskPath, IMREAD_GRAYSCALE);
+
+  while (!frame.empty ())
+    {
+      if (maskPerFrame)
+        {
+          maskImage = imread (SequenceFiller::FormatFramePath (maskPath,
+                                                               frameNumber),
+                              IMREAD_GRAYSCALE);
+        }
+      if (!(ArgumentImagesCheck (frame, maskImage))) return 1;
+
+      Mat filledFrame = sequenceFiller.FillFrame (frame, maskImage);
+
+      std::cout << MSG_FRAME << frameNumber;
+      if (sequenceFiller.IsPlanReused ()) std::cout << MSG_FRAME_SAME_MASK;
+      if (holeFiller.GetSweepsAmount () > 0)
+        {
+          std::cout << MSG_FRAME_SWEEPS << holeFiller.GetSweepsAmount ()
+                    << MSG_RESIDUAL << holeFiller.GetResidual ();
+        }
+      std::cout << std::endl;
+
+      std::string outputPath =
+          SequenceFiller::FormatFramePath (outputPattern, frameNumber);
+      if (!imwrite (outputPath, filledFrame))
+        {
+          std::cerr << MSG_ERR_SAVE_FRAME << outputPath << std::endl;
+          return 1;
+        }
+
+      frameNumber++;
+      frame = imread (SequenceFiller::FormatFramePath (framesPattern,
+                                                       frameNumber),
+                      IMREAD_COLOR);
+    }
+
+  return 0;
+}
+
+/**
+ * @brief This function runs the tiled mode: it fills an image too large to
+ * be in memory with a TiledHoleFiller, and writes it to the path given by
+ * the OPTION_TILED argument.
+ *
+ * @return An integer representing the success or failure of the fill
+ * (0 for success, 1 for failure).
+ */
+int RunTiled (int argc, char **argv)
+{
+  if (argc < TILED_ARGUMENTS_AMOUNT)
+    {
+      std::cerr << MSG_ERR_ARG_AMOUNT << std::endl;
+      return 1;
+    }
+
+  std::string outputPath (argv[1] + std::strlen (OPTION_TILED));
+
+  int z;
+  float epsilon;
+  int connectivity;
+  int algorithmType;
+  if (!(ParseArgumentNumbers (argv[TILED_ARGUMENT_Z],
+                              argv[TILED_ARGUMENT_EPSILON],
+                              argv[TILED_ARGUMENT_CONNECTIVITY],
+                              argv[TILED_ARGUMENT_ALGORITHM_TYPE], z, epsilon,
+                              connectivity, algorithmType)))
+    return 1;
+
+  OptionalArguments options;
+  if (!(ParseOptionalArguments (argc, argv, TILED_ARGUMENTS_AMOUNT, options)))
+    return 1;
+
+  HoleFiller holeFiller (z, epsilon, connectivity, algorithmType,
+                         &MyWeightFunction::GetWeight, options.threads);
+  ApplyOptionalArguments (options, holeFiller);
+  TiledHoleFiller tiledHoleFiller (holeFiller, connectivity, options.color);
+  if (!tiledHoleFiller.FillFile (argv[TILED_ARGUMENT_IMAGE],
+                                 argv[TILED_ARGUMENT_MASK], outputPath))
+    return 1;
+
+  return 0;
+}
+
 /**
  * Displays a given float image as an 8-bit unsigned integer image.
  *
@@ -189,33 +737,57 @@ int main (int argc, char **argv)
 {
 
   //Argument Handling
+  if (argc > 1 && IsOption (argv[1], OPTION_BATCH)) return RunBatch (argc, argv);
+  if (argc > 1 && IsOption (argv[1], OPTION_SEQUENCE))
+    return RunSequence (argc, argv);
+  if (argc > 1 && IsOption (argv[1], OPTION_TILED)) return RunTiled (argc, argv);
+
   if (!(ArgumentAmountCheck (argc))) return 1;
 
+  StageTimes times;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now ();
   Mat rgb_image = imread (argv[ARGUMENT_VALUE_RGB_IMAGE], IMREAD_COLOR);
-  Mat maskImage = imread (argv[ARGUMENT_VALUE_MASK_IMAGE], IMREAD_COLOR);
+  Mat maskImage = imread (argv[ARGUMENT_VALUE_MASK_IMAGE], IMREAD_GRAYSCALE);
+  times.read = GetSecondsSince (start);
 
   if (!(ArgumentImagesCheck (rgb_image, maskImage))) return 1;
 
-  char *endPtrZ;
-  int z = (int) std::strtol (argv[ARGUMENT_VALUE_Z], &endPtrZ, STRTOL_BASE);
-
-  float epsilon = std::stof (argv[ARGUMENT_VALUE_EPSILON]);
-
-  char *endPtrC;
-  int connectivity = (int) std::strtol (argv[ARGUMENT_VALUE_CONNECTIVITY],
-                                        &endPtrC, STRTOL_BASE);
-
-  char *endPtrA;
-  int algorithmType = (int) std::strtol
-      (argv[ARGUMENT_VALUE_ALGORITHM_TYPE], &endPtrA, STRTOL_BASE);
+  int z;
+  float epsilon;
+  int connectivity;
+  int algorithmType;
+  if (!(ParseArgumentNumbers (argv[ARGUMENT_VALUE_Z],
+                              argv[ARGUMENT_VALUE_EPSILON],
+                              argv[ARGUMENT_VALUE_CONNECTIVITY],
+                              argv[ARGUMENT_VALUE_ALGORITHM_TYPE], z, epsilon,
+                              connectivity, algorithmType)))
+    return 1;
 
-  if (!(ArgumentNumbersCheck (endPtrZ, epsilon, connectivity, endPtrC,
-                              algorithmType, endPtrA)))
+  OptionalArguments options;
+  if (!(ParseOptionalArguments (argc, argv, ARGUMENTS_AMOUNT, options)))
     return 1;
 
+  // Only the bounding box of the holes and their boundary is filled.
+  Rect holeRoi = ImageMasker::GetHoleRoi (maskImage);
+  bool patchOnly = !options.patchPath.empty ();
+  if (patchOnly && holeRoi.empty ())
+    {
+      std::cout << MSG_NO_HOLES << std::endl;
+      return 0;
+    }
 
   //Preprocess on the rgb_image
-  Mat imageAfterMask = ImageMasker::ApplyMask (rgb_image, maskImage);
+  start = std::chrono::steady_clock::now ();
+  Rect maskRoi = patchOnly ? holeRoi : Rect (0, 0, rgb_image.cols,
+                                             rgb_image.rows);
+  Mat imageAfterMask =
+      options.color
+          ? ImageMasker::ApplyMaskColor (rgb_image (maskRoi),
+                                         maskImage (maskRoi), options.threads)
+          : ImageMasker::ApplyMask (rgb_image (maskRoi), maskImage (maskRoi),
+                                    options.threads);
+  times.applyMask = GetSecondsSince (start);
 
   // Define a std::function object that takes four parameters and returns a
   // double value, and set the function to point to the GetWeight method of
@@ -224,10 +796,42 @@ int main (int argc, char **argv)
   weightFunction = &MyWeightFunction::GetWeight;
 
   //Filling the hole.
-  HoleFiller holeFiller(z, epsilon, connectivity, algorithmType, weightFunction);
-  Mat filledImage = holeFiller.FillImage (imageAfterMask);
-  //Saving the filled hole Image
-  imwrite (SAVING_IMAGE_NAME, filledImage);
+  HoleFiller holeFiller(z, epsilon, connectivity, algorithmType, weightFunction,
+                      options.threads);
+  ApplyOptionalArguments (options, holeFiller);
+  if (!holeRoi.empty ())
+    {
+      Mat holeImage = patchOnly ? imageAfterMask : imageAfterMask (holeRoi);
+      holeFiller.FillImageInPlace (holeImage);
+    }
+  if (holeFiller.GetSweepsAmount () > 0)
+    {
+      std::cout << MSG_SWEEPS << holeFiller.GetSweepsAmount ()
+                << MSG_RESIDUAL << holeFiller.GetResidual () << std::endl;
+    }
+
+  start = std::chrono::steady_clock::now ();
+  if (patchOnly)
+    {
+      if (!imwrite (options.patchPath, imageAfterMask))
+        {
+          std::cerr << MSG_ERR_SAVE_PATCH << options.patchPath << std::endl;
+          return 1;
+        }
+      std::cout << MSG_PATCH_OFFSET << holeRoi.x << MSG_PATCH_SEPARATOR
+                << holeRoi.y << std::endl;
+    }
+  else
+    {
+      //Saving the filled hole Image
+      imwrite (SAVING_IMAGE_NAME, imageAfterMask);
+    }
+  times.write = GetSecondsSince (start);
+
+  if (options.jsonReport)
+    {
+      PrintJsonReport (times, holeFiller.GetStatistics (), holeRoi);
+    }
 
   return 0;
 }